@@ -0,0 +1,281 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "base/constraint_simplifier.h"
+
+using std::make_pair;
+using std::map;
+using std::max;
+using std::min;
+using std::numeric_limits;
+using std::pair;
+using std::set;
+
+namespace crest {
+
+namespace {
+
+typedef map<var_t,value_t> LinearForm;
+
+// A normalized constraint: form + k op 0, where op is one of EQ, NEQ,
+// LE, or GE.
+struct NormalizedPred {
+  LinearForm form;
+  compare_op_t op;
+  value_t k;
+};
+
+enum normalize_result_t { TRUE_PRED, FALSE_PRED, NORMALIZED };
+
+const value_t kMinVal = numeric_limits<value_t>::min();
+const value_t kMaxVal = numeric_limits<value_t>::max();
+
+value_t Gcd(value_t a, value_t b) {
+  while (b != 0) {
+    value_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// Division, rounding down/up, for b > 0.
+value_t FloorDiv(value_t a, value_t b) {
+  value_t q = a / b;
+  return ((a % b != 0) && (a < 0)) ? q - 1 : q;
+}
+
+value_t CeilDiv(value_t a, value_t b) {
+  value_t q = a / b;
+  return ((a % b != 0) && (a > 0)) ? q + 1 : q;
+}
+
+bool EvalConcrete(compare_op_t op, value_t c) {
+  switch (op) {
+  case ops::EQ:  return (c == 0);
+  case ops::NEQ: return (c != 0);
+  case ops::GT:  return (c > 0);
+  case ops::LE:  return (c <= 0);
+  case ops::LT:  return (c < 0);
+  case ops::GE:  return (c >= 0);
+  }
+  return true;
+}
+
+normalize_result_t Normalize(const SymbolicPred& pred, NormalizedPred* out) {
+  const SymbolicExpr& e = pred.expr();
+  if (e.IsConcrete())
+    return EvalConcrete(pred.op(), e.const_term()) ? TRUE_PRED : FALSE_PRED;
+
+  out->form = e.terms();
+  out->op = pred.op();
+  out->k = e.const_term();
+
+  // Leave alone anything whose negation would overflow -- or whose
+  // constant would, in the step below or after it.
+  for (LinearForm::const_iterator i = out->form.begin(); i != out->form.end(); ++i) {
+    if (i->second == kMinVal)
+      return NORMALIZED;
+  }
+  if (((out->op == ops::GT) && (out->k == kMinVal))
+      || ((out->op == ops::LT) && (out->k == kMaxVal)))
+    return NORMALIZED;
+
+  // Over the integers, e > 0 iff e - 1 >= 0, and e < 0 iff e + 1 <= 0.
+  if (out->op == ops::GT) {
+    out->op = ops::GE;
+    out->k -= 1;
+  } else if (out->op == ops::LT) {
+    out->op = ops::LE;
+    out->k += 1;
+  }
+  if (out->k == kMinVal)
+    return NORMALIZED;
+
+  // Make the first coefficient positive, so that e.g. x - y >= 0 and
+  // y - x <= 0 have the same form.
+  if (out->form.begin()->second < 0) {
+    for (LinearForm::iterator i = out->form.begin(); i != out->form.end(); ++i) {
+      i->second = -i->second;
+    }
+    out->k = -out->k;
+    if (out->op == ops::GE) {
+      out->op = ops::LE;
+    } else if (out->op == ops::LE) {
+      out->op = ops::GE;
+    }
+  }
+
+  // Divide through by the GCD of the coefficients.
+  value_t g = 0;
+  for (LinearForm::const_iterator i = out->form.begin(); i != out->form.end(); ++i) {
+    g = Gcd(i->second < 0 ? -i->second : i->second, g);
+  }
+  if (g > 1) {
+    for (LinearForm::iterator i = out->form.begin(); i != out->form.end(); ++i) {
+      i->second /= g;
+    }
+    switch (out->op) {
+    case ops::GE:
+      // g*y + k >= 0  iff  y >= ceil(-k/g)  iff  y + floor(k/g) >= 0
+      out->k = FloorDiv(out->k, g);
+      break;
+    case ops::LE:
+      out->k = CeilDiv(out->k, g);
+      break;
+    case ops::EQ:
+      if (out->k % g != 0)
+        return FALSE_PRED;
+      out->k /= g;
+      break;
+    case ops::NEQ:
+      if (out->k % g != 0)
+        return TRUE_PRED;
+      out->k /= g;
+      break;
+    default:
+      break;
+    }
+  }
+
+  return NORMALIZED;
+}
+
+// Everything known about one linear form y: -ge_k <= y <= -le_k, and
+// y != -k for each k in neq_k.
+struct Interval {
+  Interval() : has_lower(false), has_upper(false), ge_k(0), le_k(0) { }
+
+  bool has_lower;
+  bool has_upper;
+  value_t ge_k;
+  value_t le_k;
+  set<value_t> neq_k;
+};
+
+}  // namespace
+
+
+ConstraintSimplifier::~ConstraintSimplifier() {
+  Clear();
+}
+
+
+void ConstraintSimplifier::Clear() {
+  for (size_t i = 0; i < owned_.size(); i++)
+    delete owned_[i];
+  owned_.clear();
+}
+
+
+bool ConstraintSimplifier::Simplify(const vector<const SymbolicPred*>& in,
+                                    vector<const SymbolicPred*>* out) {
+  Clear();
+  out->clear();
+
+  // Collect the bounds on each linear form, in order of first appearance.
+  vector< pair<LinearForm,Interval> > intervals;
+  map<LinearForm,size_t> index;
+  NormalizedPred p;
+  for (size_t i = 0; i < in.size(); i++) {
+    normalize_result_t res = Normalize(*in[i], &p);
+    if (res == TRUE_PRED)
+      continue;
+    if (res == FALSE_PRED)
+      return false;
+    if ((p.op == ops::GT) || (p.op == ops::LT)) {
+      // Could not be normalized -- pass it through untouched.
+      out->push_back(in[i]);
+      continue;
+    }
+
+    map<LinearForm,size_t>::iterator it = index.find(p.form);
+    if (it == index.end()) {
+      it = index.insert(make_pair(p.form, intervals.size())).first;
+      intervals.push_back(make_pair(p.form, Interval()));
+    }
+    Interval& iv = intervals[it->second].second;
+
+    if ((p.op == ops::GE) || (p.op == ops::EQ)) {
+      iv.ge_k = iv.has_lower ? min(iv.ge_k, p.k) : p.k;
+      iv.has_lower = true;
+    }
+    if ((p.op == ops::LE) || (p.op == ops::EQ)) {
+      iv.le_k = iv.has_upper ? max(iv.le_k, p.k) : p.k;
+      iv.has_upper = true;
+    }
+    if (p.op == ops::NEQ) {
+      iv.neq_k.insert(p.k);
+    }
+  }
+
+  for (size_t i = 0; i < intervals.size(); i++) {
+    const LinearForm& form = intervals[i].first;
+    Interval& iv = intervals[i].second;
+
+    // Disequalities at the ends of the interval shrink it.
+    while (iv.has_lower && iv.neq_k.erase(iv.ge_k)) {
+      if (iv.ge_k == kMinVal)
+        return false;
+      iv.ge_k --;
+    }
+    while (iv.has_upper && iv.neq_k.erase(iv.le_k)) {
+      if (iv.le_k == kMaxVal)
+        return false;
+      iv.le_k ++;
+    }
+    if (iv.has_lower && iv.has_upper && (iv.le_k > iv.ge_k))
+      return false;
+
+    // Build the constraints for this form.
+    SymbolicExpr y;
+    for (LinearForm::const_iterator j = form.begin(); j != form.end(); ++j) {
+      y += SymbolicExpr(j->second, j->first);
+    }
+    if (iv.has_lower && iv.has_upper && (iv.le_k == iv.ge_k)) {
+      SymbolicExpr* e = new SymbolicExpr(y);
+      *e += iv.ge_k;
+      owned_.push_back(new SymbolicPred(ops::EQ, e));
+      out->push_back(owned_.back());
+      continue;
+    }
+    if (iv.has_lower) {
+      SymbolicExpr* e = new SymbolicExpr(y);
+      *e += iv.ge_k;
+      owned_.push_back(new SymbolicPred(ops::GE, e));
+      out->push_back(owned_.back());
+    }
+    if (iv.has_upper) {
+      SymbolicExpr* e = new SymbolicExpr(y);
+      *e += iv.le_k;
+      owned_.push_back(new SymbolicPred(ops::LE, e));
+      out->push_back(owned_.back());
+    }
+    for (set<value_t>::const_iterator j = iv.neq_k.begin(); j != iv.neq_k.end(); ++j) {
+      // Drop disequalities outside of the interval.
+      if ((iv.has_lower && (*j > iv.ge_k)) || (iv.has_upper && (*j < iv.le_k)))
+        continue;
+      SymbolicExpr* e = new SymbolicExpr(y);
+      *e += *j;
+      owned_.push_back(new SymbolicPred(ops::NEQ, e));
+      out->push_back(owned_.back());
+    }
+  }
+
+  return true;
+}
+
+}  // namespace crest
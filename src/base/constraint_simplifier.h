@@ -0,0 +1,56 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef BASE_CONSTRAINT_SIMPLIFIER_H__
+#define BASE_CONSTRAINT_SIMPLIFIER_H__
+
+#include <vector>
+
+#include "base/basic_types.h"
+#include "base/symbolic_predicate.h"
+
+using std::vector;
+
+namespace crest {
+
+//
+// Simplifies a conjunction of (integer) linear constraints before it is
+// handed to a solver.
+//
+// Each constraint is normalized: strict inequalities become non-strict
+// ones, and the coefficients are divided by their GCD (rounding the
+// constant in the right direction).  Constraints over the same linear
+// form are then merged into a single interval (plus any disequalities
+// inside it), so that, e.g., x > 3, x > 5, x > 7 become just x >= 8.
+// Duplicate and implied constraints disappear along the way.
+//
+// The simplifier owns the constraints it generates, which are valid
+// until the next call to Simplify (or its destruction).
+//
+class ConstraintSimplifier {
+ public:
+  ConstraintSimplifier() { }
+  ~ConstraintSimplifier();
+
+  // Stores in 'out' a set of constraints equivalent to 'in'.  Returns
+  // false if the constraints were found to be unsatisfiable (in which
+  // case 'out' is unspecified).
+  bool Simplify(const vector<const SymbolicPred*>& in,
+                vector<const SymbolicPred*>* out);
+
+ private:
+  vector<SymbolicPred*> owned_;
+
+  void Clear();
+};
+
+}  // namespace crest
+
+#endif  // BASE_CONSTRAINT_SIMPLIFIER_H__
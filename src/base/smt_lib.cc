@@ -0,0 +1,261 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base/smt_lib.h"
+
+namespace crest {
+
+namespace {
+
+// SMT-LIB has no negative numerals: -5 is written (- 5).
+void AppendNumeral(const string& n, string* s) {
+  if (n[0] == '-') {
+    s->append("(- ");
+    s->append(n, 1, string::npos);
+    s->append(")");
+  } else {
+    s->append(n);
+  }
+}
+
+void AppendValue(value_t v, string* s) {
+  char buff[32];
+  sprintf(buff, "%lld", v);
+  AppendNumeral(buff, s);
+}
+
+void AppendVar(var_t v, string* s) {
+  char buff[32];
+  sprintf(buff, "x%u", v);
+  s->append(buff);
+}
+
+const char* kOpNames[] = { "=", "distinct", ">", "<=", "<", ">=" };
+
+
+// A parsed s-expression: either an atom or a list.
+struct SExpr {
+  bool is_atom;
+  string atom;
+  vector<SExpr> list;
+};
+
+// Reads the next token: "(", ")", or an atom.  Skips comments.
+bool NextToken(istream& in, string* tok) {
+  tok->clear();
+  int c;
+  while ((c = in.get()) != EOF) {
+    if (c == ';') {
+      while (((c = in.get()) != EOF) && (c != '\n'));
+    } else if (!isspace(c)) {
+      break;
+    }
+  }
+  if (c == EOF)
+    return false;
+
+  tok->push_back(static_cast<char>(c));
+  if ((c == '(') || (c == ')'))
+    return true;
+  while (((c = in.peek()) != EOF) && !isspace(c) && (c != '(') && (c != ')')) {
+    tok->push_back(static_cast<char>(in.get()));
+  }
+  return true;
+}
+
+bool ParseSExprRest(istream& in, const string& tok, SExpr* e) {
+  if (tok == ")")
+    return false;
+  if (tok != "(") {
+    e->is_atom = true;
+    e->atom = tok;
+    return true;
+  }
+
+  e->is_atom = false;
+  string t;
+  while (NextToken(in, &t)) {
+    if (t == ")")
+      return true;
+    e->list.push_back(SExpr());
+    if (!ParseSExprRest(in, t, &e->list.back()))
+      return false;
+  }
+  return false;
+}
+
+bool IsHead(const SExpr& e, const char* head) {
+  return (!e.is_atom && !e.list.empty()
+          && e.list[0].is_atom && (e.list[0].atom == head));
+}
+
+// Returns the text of a numeral, e.g. "-5" for (- 5).
+bool NumeralText(const SExpr& e, string* n) {
+  if (e.is_atom) {
+    *n = e.atom;
+    return isdigit(e.atom[0]);
+  }
+  if (IsHead(e, "-") && (e.list.size() == 2) && e.list[1].is_atom) {
+    *n = "-" + e.list[1].atom;
+    return true;
+  }
+  return false;
+}
+
+bool ParseValue(const SExpr& e, value_t* v) {
+  string n;
+  if (!NumeralText(e, &n))
+    return false;
+  *v = strtoll(n.c_str(), NULL, 10);
+  return true;
+}
+
+bool ParseVar(const SExpr& e, var_t* v) {
+  if (!e.is_atom || (e.atom.size() < 2) || (e.atom[0] != 'x'))
+    return false;
+  *v = static_cast<var_t>(strtoul(e.atom.c_str() + 1, NULL, 10));
+  return true;
+}
+
+// Parses a term of the form c, x, (* a x), or (+ ...) of those.
+bool ParseTerm(const SExpr& e, SymbolicExpr* expr) {
+  value_t c;
+  var_t v;
+  if (ParseValue(e, &c)) {
+    *expr += c;
+    return true;
+  }
+  if (ParseVar(e, &v)) {
+    *expr += SymbolicExpr(1, v);
+    return true;
+  }
+  if (IsHead(e, "*") && (e.list.size() == 3)
+      && ParseValue(e.list[1], &c) && ParseVar(e.list[2], &v)) {
+    *expr += SymbolicExpr(c, v);
+    return true;
+  }
+  if (IsHead(e, "+")) {
+    for (size_t i = 1; i < e.list.size(); i++) {
+      if (!ParseTerm(e.list[i], expr))
+        return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+
+void AppendSmtLib(const map<var_t,type_t>& vars,
+                  const vector<const SymbolicPred*>& constraints,
+                  string* s) {
+  typedef map<var_t,type_t>::const_iterator VarIt;
+
+  s->append("(set-logic QF_LIA)\n");
+  for (VarIt i = vars.begin(); i != vars.end(); ++i) {
+    s->append("(declare-fun ");
+    AppendVar(i->first, s);
+    s->append(" () Int)\n");
+  }
+  for (VarIt i = vars.begin(); i != vars.end(); ++i) {
+    s->append("(assert (<= ");
+    AppendNumeral(kMinValueStr[i->second], s);
+    s->push_back(' ');
+    AppendVar(i->first, s);
+    s->push_back(' ');
+    AppendNumeral(kMaxValueStr[i->second], s);
+    s->append("))\n");
+  }
+
+  for (size_t i = 0; i < constraints.size(); i++) {
+    const SymbolicExpr& e = constraints[i]->expr();
+    s->append("(assert (");
+    s->append(kOpNames[constraints[i]->op()]);
+    s->append(" (+ ");
+    AppendValue(e.const_term(), s);
+    for (SymbolicExpr::TermIt j = e.terms().begin(); j != e.terms().end(); ++j) {
+      s->append(" (* ");
+      AppendValue(j->second, s);
+      s->push_back(' ');
+      AppendVar(j->first, s);
+      s->push_back(')');
+    }
+    s->append(") 0))\n");
+  }
+  s->append("(check-sat)\n(exit)\n");
+}
+
+
+bool ParseSmtLib(istream& in,
+                 map<var_t,type_t>* vars,
+                 vector<SymbolicPred*>* constraints) {
+  vars->clear();
+  constraints->clear();
+
+  string tok;
+  while (NextToken(in, &tok)) {
+    SExpr cmd;
+    if (!ParseSExprRest(in, tok, &cmd) || cmd.is_atom)
+      return false;
+
+    if (IsHead(cmd, "declare-fun")) {
+      var_t v;
+      if ((cmd.list.size() < 2) || !ParseVar(cmd.list[1], &v))
+        return false;
+      (*vars)[v] = types::LONG_LONG;
+
+    } else if (IsHead(cmd, "assert") && (cmd.list.size() == 2)) {
+      const SExpr& p = cmd.list[1];
+      var_t v;
+      string lo, hi;
+
+      if (IsHead(p, "<=") && (p.list.size() == 4) && ParseVar(p.list[2], &v)
+          && NumeralText(p.list[1], &lo) && NumeralText(p.list[3], &hi)) {
+        // The range of a variable -- find the matching type.
+        int t;
+        for (t = types::U_CHAR; t <= types::LONG_LONG; t++) {
+          if ((lo == kMinValueStr[t]) && (hi == kMaxValueStr[t]))
+            break;
+        }
+        if (t > types::LONG_LONG)
+          return false;
+        (*vars)[v] = static_cast<type_t>(t);
+        continue;
+      }
+
+      // A constraint (op expr 0).
+      if (p.is_atom || (p.list.size() != 3) || !p.list[0].is_atom)
+        return false;
+      int op;
+      for (op = ops::EQ; op <= ops::GE; op++) {
+        if (p.list[0].atom == kOpNames[op])
+          break;
+      }
+      if (op > ops::GE)
+        return false;
+      SymbolicExpr* e = new SymbolicExpr();
+      if (!ParseTerm(p.list[1], e)) {
+        delete e;
+        return false;
+      }
+      constraints->push_back(new SymbolicPred(static_cast<compare_op_t>(op), e));
+    }
+    // Other commands (set-logic, check-sat, ...) are ignored.
+  }
+
+  return true;
+}
+
+}  // namespace crest
@@ -0,0 +1,45 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef BASE_SMT_LIB_H__
+#define BASE_SMT_LIB_H__
+
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basic_types.h"
+#include "base/symbolic_predicate.h"
+
+using std::istream;
+using std::map;
+using std::string;
+using std::vector;
+
+namespace crest {
+
+// Appends an SMT-LIB 2 (QF_LIA) script which checks the satisfiability
+// of 'constraints' over 'vars', each variable bounded by the range of
+// its type.  Variable i is named "xi".
+void AppendSmtLib(const map<var_t,type_t>& vars,
+                  const vector<const SymbolicPred*>& constraints,
+                  string* s);
+
+// Parses a script written by AppendSmtLib (and only that subset of
+// SMT-LIB).  The caller owns the returned constraints.  Returns false
+// on a parse error.
+bool ParseSmtLib(istream& in,
+                 map<var_t,type_t>* vars,
+                 vector<SymbolicPred*>* constraints);
+
+}  // namespace crest
+
+#endif  // BASE_SMT_LIB_H__
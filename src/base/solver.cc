@@ -0,0 +1,292 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <queue>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <utility>
+
+#include "base/constraint_simplifier.h"
+#include "base/smt_lib.h"
+#include "base/solver.h"
+#include "base/yices_solver.h"
+#ifdef CREST_USE_Z3
+#include "base/z3_solver.h"
+#endif
+
+using std::make_pair;
+using std::queue;
+using std::set;
+
+namespace crest {
+
+typedef vector<const SymbolicPred*>::const_iterator PredIt;
+
+namespace {
+
+double WallTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+typedef set<var_t>::const_iterator VarIt;
+
+// Stores in 'slice' the constraints which (transitively) share
+// variables with the last of 'constraints', and their variables in
+// 'slice_vars'.
+void Slice(const map<var_t,type_t>& vars,
+           const vector<const SymbolicPred*>& constraints,
+           map<var_t,type_t>* slice_vars,
+           vector<const SymbolicPred*>* slice) {
+  set<var_t> tmp;
+
+  // Build a graph on the variables, indicating a dependence when two
+  // variables co-occur in a symbolic predicate.
+  vector< set<var_t> > depends(vars.size());
+  for (PredIt i = constraints.begin(); i != constraints.end(); ++i) {
+    tmp.clear();
+    (*i)->AppendVars(&tmp);
+    for (VarIt j = tmp.begin(); j != tmp.end(); ++j) {
+      depends[*j].insert(tmp.begin(), tmp.end());
+    }
+  }
+
+  // Initialize the set of dependent variables to those in the last
+  // constraint.  Also, initialize the queue for the BFS.
+  slice_vars->clear();
+  queue<var_t> Q;
+  tmp.clear();
+  constraints.back()->AppendVars(&tmp);
+  for (VarIt j = tmp.begin(); j != tmp.end(); ++j) {
+    slice_vars->insert(*vars.find(*j));
+    Q.push(*j);
+  }
+
+  // Run the BFS.
+  while (!Q.empty()) {
+    var_t i = Q.front();
+    Q.pop();
+    for (VarIt j = depends[i].begin(); j != depends[i].end(); ++j) {
+      if (slice_vars->find(*j) == slice_vars->end()) {
+	Q.push(*j);
+	slice_vars->insert(*vars.find(*j));
+      }
+    }
+  }
+
+  // Generate the list of dependent constraints.
+  slice->clear();
+  for (PredIt i = constraints.begin(); i != constraints.end(); ++i) {
+    if ((*i)->DependsOn(*slice_vars))
+      slice->push_back(*i);
+  }
+}
+
+}  // namespace
+
+
+const char* SolveResultName(solve_result_t result) {
+  switch (result) {
+  case results::SAT:   return "sat";
+  case results::UNSAT: return "unsat";
+  default:             return "unknown";
+  }
+}
+
+
+Solver::Solver() : timeout_(0), num_dumped_(0) { }
+
+Solver::~Solver() { }
+
+
+Solver* Solver::Create(const string& name) {
+  if (name == "yices")
+    return new YicesSolver();
+#ifdef CREST_USE_Z3
+  if (name == "z3")
+    return new Z3Solver();
+#endif
+  return NULL;
+}
+
+
+solve_result_t Solver::Solve(const map<var_t,type_t>& vars,
+                             const vector<const SymbolicPred*>& constraints,
+                             map<var_t,value_t>* soln) {
+  double start = WallTime();
+
+  Reset(vars);
+  for (PredIt i = constraints.begin(); i != constraints.end(); ++i) {
+    Assert(**i);
+  }
+  solve_result_t result = Check(soln);
+
+  double elapsed = WallTime() - start;
+  RecordQuery(result, elapsed);
+  if (!dump_dir_.empty())
+    DumpQuery(vars, constraints, result, elapsed);
+
+  return result;
+}
+
+
+void Solver::SolveNegations(const map<var_t,type_t>& vars,
+                            const vector<const SymbolicPred*>& constraints,
+                            const vector<const SymbolicPred*>& negations,
+                            const vector<size_t>& idxs,
+                            vector<solve_result_t>* res,
+                            vector< map<var_t,value_t> >* solns,
+                            vector<double>* seconds) {
+  res->resize(idxs.size());
+  solns->resize(idxs.size());
+  seconds->resize(idxs.size());
+  if (idxs.empty())
+    return;
+
+  // Declare only the variables which the constraints mention.
+  set<var_t> used;
+  for (size_t i = 0; i <= idxs.back(); i++) {
+    constraints[i]->AppendVars(&used);
+  }
+  map<var_t,type_t> used_vars;
+  for (set<var_t>::const_iterator i = used.begin(); i != used.end(); ++i) {
+    used_vars.insert(*vars.find(*i));
+  }
+  Reset(used_vars);
+
+  // Each negation is solved over only its slice of the prefix, with
+  // redundant constraints dropped (as in IncrementalSolve), so the
+  // prefix cannot be asserted once and shared.  The slices are usually
+  // far smaller than the whole prefix, and solving over them leaves
+  // the input variables outside them unchanged.
+  ConstraintSimplifier simplifier;
+  vector<const SymbolicPred*> cs;
+  map<var_t,type_t> slice_vars;
+  vector<const SymbolicPred*> slice;
+  vector<const SymbolicPred*> simplified;
+  map<var_t,value_t> soln;
+  for (size_t k = 0; k < idxs.size(); k++) {
+    double start = WallTime();
+    cs.assign(constraints.begin(), constraints.begin() + idxs[k]);
+    cs.push_back(negations[k]);
+    Slice(vars, cs, &slice_vars, &slice);
+
+    (*solns)[k].clear();
+    bool feasible = simplifier.Simplify(slice, &simplified);
+    if (!feasible) {
+      (*res)[k] = results::UNSAT;
+    } else {
+      Push();
+      for (PredIt i = simplified.begin(); i != simplified.end(); ++i) {
+        Assert(**i);
+      }
+      soln.clear();
+      (*res)[k] = Check(&soln);
+      Pop();
+      // (The model covers every declared variable.)
+      typedef map<var_t,value_t>::const_iterator SolnIt;
+      for (SolnIt i = soln.begin(); i != soln.end(); ++i) {
+        if (slice_vars.count(i->first))
+          (*solns)[k].insert(*i);
+      }
+    }
+
+    double elapsed = WallTime() - start;
+    (*seconds)[k] = elapsed;
+    RecordQuery((*res)[k], elapsed);
+    if (!dump_dir_.empty())
+      DumpQuery(slice_vars, feasible ? simplified : slice, (*res)[k], elapsed);
+  }
+}
+
+
+void Solver::RecordQuery(solve_result_t result, double seconds) {
+  stats_.num_queries ++;
+  switch (result) {
+  case results::SAT:     stats_.num_sat ++; break;
+  case results::UNSAT:   stats_.num_unsat ++; break;
+  case results::UNKNOWN: stats_.num_unknown ++; break;
+  }
+  stats_.solve_time += seconds;
+}
+
+
+void Solver::DumpQuery(const map<var_t,type_t>& vars,
+                       const vector<const SymbolicPred*>& constraints,
+                       solve_result_t result, double seconds) {
+  // Solver workers dump concurrently, so file names include the pid.
+  char fname[64];
+  snprintf(fname, sizeof(fname), "q%d-%u.smt2", getpid(), num_dumped_++);
+
+  string script;
+  AppendSmtLib(vars, constraints, &script);
+  string path = dump_dir_ + "/" + fname;
+  FILE* f = fopen(path.c_str(), "w");
+  if (!f) {
+    fprintf(stderr, "Failed to open %s.\n", path.c_str());
+    perror("Error: ");
+    exit(-1);
+  }
+  fwrite(script.data(), 1, script.size(), f);
+  fclose(f);
+
+  // Each index line goes out in a single (appending) write.
+  path = dump_dir_ + "/index";
+  f = fopen(path.c_str(), "a");
+  if (!f) {
+    fprintf(stderr, "Failed to open %s.\n", path.c_str());
+    perror("Error: ");
+    exit(-1);
+  }
+  fprintf(f, "%s %s %.6f\n", fname, SolveResultName(result), seconds);
+  fclose(f);
+}
+
+
+solve_result_t Solver::IncrementalSolve(const vector<value_t>& old_soln,
+                                        const map<var_t,type_t>& vars,
+                                        const vector<const SymbolicPred*>& constraints,
+                                        map<var_t,value_t>* soln) {
+  map<var_t,type_t> dependent_vars;
+  vector<const SymbolicPred*> dependent_constraints;
+  Slice(vars, constraints, &dependent_vars, &dependent_constraints);
+
+  // Drop redundant constraints (e.g. the long runs of bounds from loops).
+  ConstraintSimplifier simplifier;
+  vector<const SymbolicPred*> simplified;
+  soln->clear();
+  if (!simplifier.Simplify(dependent_constraints, &simplified)) {
+    stats_.num_queries ++;
+    stats_.num_unsat ++;
+    return results::UNSAT;
+  }
+
+  solve_result_t result = Solve(dependent_vars, simplified, soln);
+  if (result == results::SAT) {
+    // Merge in the constrained variables.
+    set<var_t> tmp;
+    for (PredIt i = constraints.begin(); i != constraints.end(); ++i) {
+      (*i)->AppendVars(&tmp);
+    }
+    for (VarIt i = tmp.begin(); i != tmp.end(); ++i) {
+      if (soln->find(*i) == soln->end()) {
+	soln->insert(make_pair(*i, old_soln[*i]));
+      }
+    }
+  }
+
+  return result;
+}
+
+}  // namespace crest
@@ -0,0 +1,148 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef BASE_SOLVER_H__
+#define BASE_SOLVER_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basic_types.h"
+#include "base/symbolic_predicate.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace crest {
+
+// Outcome of a solver query.  UNKNOWN indicates that the solver gave up
+// (e.g. it ran out of time) without deciding the query.
+namespace results {
+enum solve_result_t { SAT = 0, UNSAT = 1, UNKNOWN = 2 };
+}
+using results::solve_result_t;
+
+// Returns "sat", "unsat", or "unknown".
+const char* SolveResultName(solve_result_t result);
+
+//
+// Abstract interface to a constraint solver backend.
+//
+// A backend implements the incremental primitives (Reset, Push, Pop,
+// Assert, and Check).  Solve and IncrementalSolve are built on top of
+// them, and keep the statistics for every backend.
+//
+class Solver {
+ public:
+  struct Stats {
+    Stats()
+      : num_queries(0), num_sat(0), num_unsat(0), num_unknown(0),
+        solve_time(0) { }
+
+    void Add(const Stats& s) {
+      num_queries += s.num_queries;
+      num_sat += s.num_sat;
+      num_unsat += s.num_unsat;
+      num_unknown += s.num_unknown;
+      solve_time += s.solve_time;
+    }
+
+    unsigned num_queries;
+    unsigned num_sat;
+    unsigned num_unsat;
+    unsigned num_unknown;
+    double solve_time;  // In seconds.
+  };
+
+  Solver();
+  virtual ~Solver();
+
+  // Returns a new solver backend with the given name ("yices", or "z3"
+  // when built with Z3 support), or NULL if there is no such backend.
+  static Solver* Create(const string& name);
+
+  virtual const char* name() const = 0;
+
+  // Starts a fresh context, declaring the given variables (each bounded
+  // by the range of its type).
+  virtual void Reset(const map<var_t,type_t>& vars) = 0;
+
+  // Saves/restores the set of asserted constraints.
+  virtual void Push() = 0;
+  virtual void Pop() = 0;
+
+  virtual void Assert(const SymbolicPred& pred) = 0;
+
+  // Checks the satisfiability of the asserted constraints, storing a
+  // model for the declared variables in 'soln' if SAT.
+  virtual solve_result_t Check(map<var_t,value_t>* soln) = 0;
+
+  // Can the backend itself stop a query when the timeout expires?
+  virtual bool SupportsTimeout() const { return false; }
+
+  // Solves 'constraints' over 'vars' from scratch.
+  solve_result_t Solve(const map<var_t,type_t>& vars,
+                       const vector<const SymbolicPred*>& constraints,
+                       map<var_t,value_t>* soln);
+
+  // Solves only those constraints which (transitively) share variables
+  // with the last constraint -- assumed to be the only new one -- and
+  // fills in the rest of the solution from 'old_soln'.
+  solve_result_t IncrementalSolve(const vector<value_t>& old_soln,
+                                  const map<var_t,type_t>& vars,
+                                  const vector<const SymbolicPred*>& constraints,
+                                  map<var_t,value_t>* soln);
+
+  // For each k, solves constraints[0..idxs[k]-1] together with
+  // negations[k] (for 'idxs' in increasing order), all in one context.
+  // As in IncrementalSolve, each query is only the slice of constraints
+  // sharing variables with the negation (simplified), pushed and popped
+  // in turn.  Solutions cover only the variables of each slice.  The
+  // time taken by each query is stored in 'seconds'.
+  void SolveNegations(const map<var_t,type_t>& vars,
+                      const vector<const SymbolicPred*>& constraints,
+                      const vector<const SymbolicPred*>& negations,
+                      const vector<size_t>& idxs,
+                      vector<solve_result_t>* res,
+                      vector< map<var_t,value_t> >* solns,
+                      vector<double>* seconds);
+
+  // Time limit for each query, in seconds (zero for none).  Backends
+  // which cannot interrupt a query ignore the limit -- it is up to the
+  // caller to enforce it (see SolverPool).
+  void set_timeout(double seconds) { timeout_ = seconds; }
+  double timeout() const { return timeout_; }
+
+  // Writes each query solved (as an SMT-LIB script) to a file in
+  // directory 'dir', and appends a line "<file> <result> <seconds>"
+  // describing it to 'dir'/index.  An empty 'dir' turns this off.
+  void set_dump_dir(const string& dir) { dump_dir_ = dir; }
+
+  const Stats& stats() const { return stats_; }
+  void ResetStats() { stats_ = Stats(); }
+
+ private:
+  double timeout_;
+  Stats stats_;
+
+  string dump_dir_;
+  unsigned num_dumped_;
+
+  void RecordQuery(solve_result_t result, double seconds);
+  void DumpQuery(const map<var_t,type_t>& vars,
+                 const vector<const SymbolicPred*>& constraints,
+                 solve_result_t result, double seconds);
+};
+
+}  // namespace crest
+
+#endif  // BASE_SOLVER_H__
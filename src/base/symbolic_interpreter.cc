@@ -18,6 +18,7 @@
 #include "base/yices_solver.h"
 
 using std::make_pair;
+using std::max;
 using std::swap;
 using std::vector;
 
@@ -252,7 +253,7 @@ void SymbolicInterpreter::ApplyCompareOp(id_t id, compare_op_t op, value_t value
 
 void SymbolicInterpreter::Call(id_t id, function_id_t fid) {
   IFDEBUG(fprintf(stderr, "call %u\n", fid));
-  ex_.mutable_path()->Push(kCallId);
+  ex_.mutable_path()->PushCall(fid);
   IFDEBUG(DumpMemory());
 }
 
@@ -303,6 +304,17 @@ void SymbolicInterpreter::Branch(id_t id, branch_id_t bid, bool pred_value) {
 
   ex_.mutable_path()->Push(bid, pred_);
   pred_ = NULL;
+
+  // Keep a summary of the distinct branches taken, so that the search
+  // need not scan the whole path for coverage.
+  if (bid >= 0) {
+    if (static_cast<size_t>(bid) >= taken_.size())
+      taken_.resize(max(2 * taken_.size(), static_cast<size_t>(bid) + 1));
+    if (!taken_[bid]) {
+      taken_[bid] = true;
+      ex_.mutable_path()->PushDistinct(bid);
+    }
+  }
   IFDEBUG(DumpMemory());
 }
 
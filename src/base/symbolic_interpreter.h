@@ -78,6 +78,9 @@ class SymbolicInterpreter {
   // The symbolic execution (program path and inputs).
   SymbolicExecution ex_;
 
+  // The branches taken so far (indexed by branch id).
+  vector<bool> taken_;
+
   // Number of symbolic inputs so far.
   unsigned int num_inputs_;
 
@@ -8,13 +8,18 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
 // for details.
 
+#include <algorithm>
+#include <assert.h>
+
 #include "base/symbolic_path.h"
 
+using std::min;
+
 namespace crest {
 
-SymbolicPath::SymbolicPath() { }
+SymbolicPath::SymbolicPath() : num_shared_(0) { }
 
-SymbolicPath::SymbolicPath(bool pre_allocate) {
+SymbolicPath::SymbolicPath(bool pre_allocate) : num_shared_(0) {
   if (pre_allocate) {
     // To cut down on re-allocation.
     branches_.reserve(4000000);
@@ -24,7 +29,7 @@ SymbolicPath::SymbolicPath(bool pre_allocate) {
 }
 
 SymbolicPath::~SymbolicPath() {
-  for (size_t i = 0; i < constraints_.size(); i++)
+  for (size_t i = num_shared_; i < constraints_.size(); i++)
     delete constraints_[i];
 }
 
@@ -32,12 +37,34 @@ void SymbolicPath::Swap(SymbolicPath& sp) {
   branches_.swap(sp.branches_);
   constraints_idx_.swap(sp.constraints_idx_);
   constraints_.swap(sp.constraints_);
+  swap(num_shared_, sp.num_shared_);
+  calls_.swap(sp.calls_);
+  distinct_branches_.swap(sp.distinct_branches_);
+  frame_end_.swap(sp.frame_end_);
 }
 
 void SymbolicPath::Push(branch_id_t bid) {
   branches_.push_back(bid);
 }
 
+void SymbolicPath::PushCall(function_id_t fid) {
+  branches_.push_back(kCallId);
+  calls_.push_back(fid);
+}
+
+void SymbolicPath::RemapBranches(const vector<branch_id_t>& ids) {
+  typedef vector<branch_id_t>::iterator BranchIt;
+  for (BranchIt i = branches_.begin(); i != branches_.end(); ++i) {
+    if (*i >= 0)
+      *i = (static_cast<size_t>(*i) < ids.size()) ? ids[*i] : 0;
+  }
+  for (BranchIt i = distinct_branches_.begin();
+       i != distinct_branches_.end(); ++i) {
+    if (*i >= 0)
+      *i = (static_cast<size_t>(*i) < ids.size()) ? ids[*i] : 0;
+  }
+}
+
 void SymbolicPath::Push(branch_id_t bid, SymbolicPred* constraint) {
   if (constraint) {
     constraints_.push_back(constraint);
@@ -46,6 +73,43 @@ void SymbolicPath::Push(branch_id_t bid, SymbolicPred* constraint) {
   branches_.push_back(bid);
 }
 
+size_t SymbolicPath::SharePrefix(const SymbolicPath& path, size_t n) {
+  assert(num_shared_ == 0);
+  n = min(n, min(constraints_.size(), path.constraints_.size()));
+  while ((num_shared_ < n)
+         && (constraints_idx_[num_shared_] == path.constraints_idx_[num_shared_])
+         && constraints_[num_shared_]->Equal(*path.constraints_[num_shared_])) {
+    delete constraints_[num_shared_];
+    constraints_[num_shared_] = path.constraints_[num_shared_];
+    num_shared_++;
+  }
+  return num_shared_;
+}
+
+size_t SymbolicPath::FrameEnd(size_t i) const {
+  // (Pushing onto the path changes its length, which invalidates the
+  // index.)
+  const size_t n = branches_.size();
+  if (frame_end_.size() != n + 1) {
+    // Computed backwards: a return ends its own call, a call is skipped
+    // to just past its matching return, and anything else is in the
+    // same call as the next index.
+    frame_end_.resize(n + 1);
+    frame_end_[n] = n;
+    for (size_t j = n; j-- > 0; ) {
+      if (branches_[j] == kReturnId) {
+        frame_end_[j] = j;
+      } else if (branches_[j] == kCallId) {
+        size_t ret = frame_end_[j + 1];
+        frame_end_[j] = (ret < n) ? frame_end_[ret + 1] : n;
+      } else {
+        frame_end_[j] = frame_end_[j + 1];
+      }
+    }
+  }
+  return (i < n) ? frame_end_[i] : n;
+}
+
 void SymbolicPath::Serialize(string* s) const {
   typedef vector<SymbolicPred*>::const_iterator ConIt;
 
@@ -54,6 +118,20 @@ void SymbolicPath::Serialize(string* s) const {
   s->append((char*)&len, sizeof(len));
   s->append((char*)&branches_.front(), branches_.size() * sizeof(branch_id_t));
 
+  // Write the called functions.
+  len = calls_.size();
+  s->append((char*)&len, sizeof(len));
+  if (len > 0)
+    s->append((char*)&calls_.front(), len * sizeof(function_id_t));
+
+  // Write the distinct branches.
+  len = distinct_branches_.size();
+  s->append((char*)&len, sizeof(len));
+  if (len > 0) {
+    s->append((char*)&distinct_branches_.front(),
+              len * sizeof(branch_id_t));
+  }
+
   // Write the path constraints.
   len = constraints_.size();
   s->append((char*)&len, sizeof(len));
@@ -68,15 +146,37 @@ bool SymbolicPath::Parse(istream& s) {
   size_t len;
 
   // Read the path.
+  frame_end_.clear();
   s.read((char*)&len, sizeof(size_t));
   branches_.resize(len);
   s.read((char*)&branches_.front(), len * sizeof(branch_id_t));
   if (s.fail())
     return false;
 
+  // Read the called functions.
+  s.read((char*)&len, sizeof(size_t));
+  if (s.fail())
+    return false;
+  calls_.resize(len);
+  if (len > 0)
+    s.read((char*)&calls_.front(), len * sizeof(function_id_t));
+  if (s.fail())
+    return false;
+
+  // Read the distinct branches.
+  s.read((char*)&len, sizeof(size_t));
+  if (s.fail())
+    return false;
+  distinct_branches_.resize(len);
+  if (len > 0)
+    s.read((char*)&distinct_branches_.front(), len * sizeof(branch_id_t));
+  if (s.fail())
+    return false;
+
   // Clean up any existing path constraints.
-  for (size_t i = 0; i < constraints_.size(); i++)
+  for (size_t i = num_shared_; i < constraints_.size(); i++)
     delete constraints_[i];
+  num_shared_ = 0;
 
   // Read the path constraints.
   s.read((char*)&len, sizeof(size_t));
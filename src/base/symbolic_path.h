@@ -36,17 +36,53 @@ class SymbolicPath {
 
   void Push(branch_id_t bid);
   void Push(branch_id_t bid, SymbolicPred* constraint);
+  // Pushes a kCallId marker for a call to function 'fid'.
+  void PushCall(function_id_t fid);
+
+  // Records that branch 'bid' was taken for the first time.
+  void PushDistinct(branch_id_t bid) { distinct_branches_.push_back(bid); }
+
+  // Shares the leading constraints, among the first 'n', which are equal
+  // to those of 'path' (at the same indices) -- instead of keeping copies
+  // of them.  'path' must outlive this path, or at least its next Parse.
+  // Returns the number of constraints shared.
+  size_t SharePrefix(const SymbolicPath& path, size_t n);
+  size_t num_shared_constraints() const { return num_shared_; }
+
+  // Replaces each branch id b (but not the call and return markers) with
+  // ids[b], or with 0 if b is beyond the end of 'ids'.
+  void RemapBranches(const vector<branch_id_t>& ids);
   void Serialize(string* s) const;
   bool Parse(istream& s);
 
   const vector<branch_id_t>& branches() const { return branches_; }
   const vector<SymbolicPred*>& constraints() const { return constraints_; }
   const vector<size_t>& constraints_idx() const { return constraints_idx_; }
+  // The function called at each kCallId marker in branches(), in order.
+  const vector<function_id_t>& calls() const { return calls_; }
+
+  // The distinct branch ids in branches(), in the order first taken.
+  const vector<branch_id_t>& distinct_branches() const {
+    return distinct_branches_;
+  }
+
+  // The index of the kReturnId which ends the call containing index 'i'
+  // of branches() -- skipping over any calls made from index 'i' on --
+  // or branches().size() if the call does not return.  (The index is
+  // computed for the whole path on first use.)
+  size_t FrameEnd(size_t i) const;
 
  private:
   vector<branch_id_t> branches_;
   vector<size_t> constraints_idx_;
   vector<SymbolicPred*> constraints_;
+  size_t num_shared_;  // The first num_shared_ constraints are not owned.
+  vector<function_id_t> calls_;
+  vector<branch_id_t> distinct_branches_;
+
+  // FrameEnd() for each index (and for branches_.size()), if computed
+  // for the current branches_.
+  mutable vector<size_t> frame_end_;
 };
 
 }  // namespace crest
@@ -10,25 +10,17 @@
 
 #include <assert.h>
 #include <limits>
-#include <queue>
-#include <set>
 #include <stdio.h>
 #include <stdlib.h>
 #include <utility>
-#include <yices_c.h>
 
 #include "base/yices_solver.h"
 
 using std::make_pair;
 using std::numeric_limits;
-using std::queue;
-using std::set;
 
 namespace crest {
 
-typedef vector<const SymbolicPred*>::const_iterator PredIt;
-
-
 yices_expr makeYicesNum(yices_context ctx, value_t val) {
   if ((val >= numeric_limits<int>::min()) && (val <= numeric_limits<int>::max())) {
     return yices_mk_num(ctx, static_cast<int>(val));
@@ -45,161 +37,114 @@ yices_expr makeYicesNum(yices_context ctx, value_t val) {
 }
 
 
-bool YicesSolver::IncrementalSolve(const vector<value_t>& old_soln,
-				   const map<var_t,type_t>& vars,
-				   const vector<const SymbolicPred*>& constraints,
-				   map<var_t,value_t>* soln) {
-  set<var_t> tmp;
-  typedef set<var_t>::const_iterator VarIt;
-
-  // Build a graph on the variables, indicating a dependence when two
-  // variables co-occur in a symbolic predicate.
-  vector< set<var_t> > depends(vars.size());
-  for (PredIt i = constraints.begin(); i != constraints.end(); ++i) {
-    tmp.clear();
-    (*i)->AppendVars(&tmp);
-    for (VarIt j = tmp.begin(); j != tmp.end(); ++j) {
-      depends[*j].insert(tmp.begin(), tmp.end());
-    }
-  }
-
-  // Initialize the set of dependent variables to those in the constraints.
-  // (Assumption: Last element of constraints is the only new constraint.)
-  // Also, initialize the queue for the BFS.
-  map<var_t,type_t> dependent_vars;
-  queue<var_t> Q;
-  tmp.clear();
-  constraints.back()->AppendVars(&tmp);
-  for (VarIt j = tmp.begin(); j != tmp.end(); ++j) {
-    dependent_vars.insert(*vars.find(*j));
-    Q.push(*j);
-  }
-
-  // Run the BFS.
-  while (!Q.empty()) {
-    var_t i = Q.front();
-    Q.pop();
-    for (VarIt j = depends[i].begin(); j != depends[i].end(); ++j) {
-      if (dependent_vars.find(*j) == dependent_vars.end()) {
-	Q.push(*j);
-	dependent_vars.insert(*vars.find(*j));
-      }
-    }
-  }
-
-  // Generate the list of dependent constraints.
-  vector<const SymbolicPred*> dependent_constraints;
-  for (PredIt i = constraints.begin(); i != constraints.end(); ++i) {
-    if ((*i)->DependsOn(dependent_vars))
-      dependent_constraints.push_back(*i);
-  }
-
-  soln->clear();
-  if (Solve(dependent_vars, dependent_constraints, soln)) {
-    // Merge in the constrained variables.
-    for (PredIt i = constraints.begin(); i != constraints.end(); ++i) {
-      (*i)->AppendVars(&tmp);
-    }
-    for (set<var_t>::const_iterator i = tmp.begin(); i != tmp.end(); ++i) {
-      if (soln->find(*i) == soln->end()) {
-	soln->insert(make_pair(*i, old_soln[*i]));
-      }
-    }
-    return true;
-  }
+YicesSolver::YicesSolver() : ctx_(NULL), zero_(NULL) { }
 
-  return false;
+YicesSolver::~YicesSolver() {
+  if (ctx_)
+    yices_del_context(ctx_);
 }
 
 
-bool YicesSolver::Solve(const map<var_t,type_t>& vars,
-			const vector<const SymbolicPred*>& constraints,
-			map<var_t,value_t>* soln) {
-
+void YicesSolver::Reset(const map<var_t,type_t>& vars) {
   typedef map<var_t,type_t>::const_iterator VarIt;
 
+  if (ctx_)
+    yices_del_context(ctx_);
+  x_decl_.clear();
+  x_expr_.clear();
+
   // yices_enable_log_file("yices_log");
-  yices_context ctx = yices_mk_context();
-  assert(ctx);
+  ctx_ = yices_mk_context();
+  assert(ctx_);
 
   // Type limits.
   vector<yices_expr> min_expr(types::LONG_LONG+1);
   vector<yices_expr> max_expr(types::LONG_LONG+1);
   for (int i = types::U_CHAR; i <= types::LONG_LONG; i++) {
-    min_expr[i] = yices_mk_num_from_string(ctx, const_cast<char*>(kMinValueStr[i]));
-    max_expr[i] = yices_mk_num_from_string(ctx, const_cast<char*>(kMaxValueStr[i]));
+    min_expr[i] = yices_mk_num_from_string(ctx_, const_cast<char*>(kMinValueStr[i]));
+    max_expr[i] = yices_mk_num_from_string(ctx_, const_cast<char*>(kMaxValueStr[i]));
     assert(min_expr[i]);
     assert(max_expr[i]);
   }
 
   char int_ty_name[] = "int";
-  // fprintf(stderr, "yices_mk_mk_type(ctx, int_ty_name)\n");
-  yices_type int_ty = yices_mk_type(ctx, int_ty_name);
+  yices_type int_ty = yices_mk_type(ctx_, int_ty_name);
   assert(int_ty);
 
   // Variable declarations.
-  map<var_t,yices_var_decl> x_decl;
-  map<var_t,yices_expr> x_expr;
   for (VarIt i = vars.begin(); i != vars.end(); ++i) {
     char buff[32];
     snprintf(buff, sizeof(buff), "x%d", i->first);
-    // fprintf(stderr, "yices_mk_var_decl(ctx, buff, int_ty)\n");
-    x_decl[i->first] = yices_mk_var_decl(ctx, buff, int_ty);
-    // fprintf(stderr, "yices_mk_var_from_decl(ctx, x_decl[i->first])\n");
-    x_expr[i->first] = yices_mk_var_from_decl(ctx, x_decl[i->first]);
-    assert(x_decl[i->first]);
-    assert(x_expr[i->first]);
-    // fprintf(stderr, "yices_assert(ctx, yices_mk_ge(ctx, x_expr[i->first], min_expr[i->second]))\n");
-    yices_assert(ctx, yices_mk_ge(ctx, x_expr[i->first], min_expr[i->second]));
-    // fprintf(stderr, "yices_assert(ctx, yices_mk_le(ctx, x_expr[i->first], max_expr[i->second]))\n");
-    yices_assert(ctx, yices_mk_le(ctx, x_expr[i->first], max_expr[i->second]));
+    x_decl_[i->first] = yices_mk_var_decl(ctx_, buff, int_ty);
+    x_expr_[i->first] = yices_mk_var_from_decl(ctx_, x_decl_[i->first]);
+    assert(x_decl_[i->first]);
+    assert(x_expr_[i->first]);
+    yices_assert(ctx_, yices_mk_ge(ctx_, x_expr_[i->first], min_expr[i->second]));
+    yices_assert(ctx_, yices_mk_le(ctx_, x_expr_[i->first], max_expr[i->second]));
   }
 
-  // fprintf(stderr, "yices_mk_num(ctx, 0)\n");
-  yices_expr zero = yices_mk_num(ctx, 0);
-  assert(zero);
-
-  { // Constraints.
-    vector<yices_expr> terms;
-    for (PredIt i = constraints.begin(); i != constraints.end(); ++i) {
-      const SymbolicExpr& se = (*i)->expr();
-      terms.clear();
-      terms.push_back(makeYicesNum(ctx, se.const_term()));
-      for (SymbolicExpr::TermIt j = se.terms().begin(); j != se.terms().end(); ++j) {
-	yices_expr prod[2] = { x_expr[j->first], makeYicesNum(ctx, j->second) };
-	terms.push_back(yices_mk_mul(ctx, prod, 2));
-      }
-      yices_expr e = yices_mk_sum(ctx, &terms.front(), terms.size());
-
-      yices_expr pred;
-      switch((*i)->op()) {
-      case ops::EQ:  pred = yices_mk_eq(ctx, e, zero); break;
-      case ops::NEQ: pred = yices_mk_diseq(ctx, e, zero); break;
-      case ops::GT:  pred = yices_mk_gt(ctx, e, zero); break;
-      case ops::LE:  pred = yices_mk_le(ctx, e, zero); break;
-      case ops::LT:  pred = yices_mk_lt(ctx, e, zero); break;
-      case ops::GE:  pred = yices_mk_ge(ctx, e, zero); break;
-      default:
-	fprintf(stderr, "Unknown comparison operator: %d\n", (*i)->op());
-	exit(1);
-      }
-      yices_assert(ctx, pred);
-    }
+  zero_ = yices_mk_num(ctx_, 0);
+  assert(zero_);
+}
+
+
+void YicesSolver::Push() {
+  yices_push(ctx_);
+}
+
+
+void YicesSolver::Pop() {
+  yices_pop(ctx_);
+}
+
+
+void YicesSolver::Assert(const SymbolicPred& pred) {
+  const SymbolicExpr& se = pred.expr();
+  vector<yices_expr> terms;
+  terms.push_back(makeYicesNum(ctx_, se.const_term()));
+  for (SymbolicExpr::TermIt j = se.terms().begin(); j != se.terms().end(); ++j) {
+    yices_expr prod[2] = { x_expr_[j->first], makeYicesNum(ctx_, j->second) };
+    terms.push_back(yices_mk_mul(ctx_, prod, 2));
+  }
+  yices_expr e = yices_mk_sum(ctx_, &terms.front(), terms.size());
+
+  yices_expr p;
+  switch(pred.op()) {
+  case ops::EQ:  p = yices_mk_eq(ctx_, e, zero_); break;
+  case ops::NEQ: p = yices_mk_diseq(ctx_, e, zero_); break;
+  case ops::GT:  p = yices_mk_gt(ctx_, e, zero_); break;
+  case ops::LE:  p = yices_mk_le(ctx_, e, zero_); break;
+  case ops::LT:  p = yices_mk_lt(ctx_, e, zero_); break;
+  case ops::GE:  p = yices_mk_ge(ctx_, e, zero_); break;
+  default:
+    fprintf(stderr, "Unknown comparison operator: %d\n", pred.op());
+    exit(1);
   }
+  yices_assert(ctx_, p);
+}
+
+
+solve_result_t YicesSolver::Check(map<var_t,value_t>* soln) {
+  typedef map<var_t,yices_var_decl>::const_iterator DeclIt;
+
+  lbool res = yices_check(ctx_);
+  if (res == l_false)
+    return results::UNSAT;
+  if (res == l_undef)
+    return results::UNKNOWN;
 
-  bool success = (yices_check(ctx) == l_true);
-  if (success) {
+  {
     soln->clear();
-    yices_model model = yices_get_model(ctx);
-    for (VarIt i = vars.begin(); i != vars.end(); ++i) {
+    yices_model model = yices_get_model(ctx_);
+    for (DeclIt i = x_decl_.begin(); i != x_decl_.end(); ++i) {
       long val;
-      assert(yices_get_int_value(model, x_decl[i->first], &val));
+      bool ok = yices_get_int_value(model, i->second, &val);
+      assert(ok);
       soln->insert(make_pair(i->first, val));
     }
   }
 
-  yices_del_context(ctx);
-  return success;
+  return results::SAT;
 }
 
 
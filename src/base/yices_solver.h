@@ -13,8 +13,10 @@
 
 #include <map>
 #include <vector>
+#include <yices_c.h>
 
 #include "base/basic_types.h"
+#include "base/solver.h"
 #include "base/symbolic_predicate.h"
 
 using std::map;
@@ -22,19 +24,26 @@ using std::vector;
 
 namespace crest {
 
-class YicesSolver {
+// Solver backend for the Yices 1 C API.  (Yices 1 cannot interrupt a
+// query, so the timeout is ignored.)
+class YicesSolver : public Solver {
  public:
-  static bool IncrementalSolve(const vector<value_t>& old_soln,
-			       const map<var_t,type_t>& vars,
-                               const vector<const SymbolicPred*>& constraints,
-			       map<var_t,value_t>* soln);
-
-  static bool Solve(const map<var_t,type_t>& vars,
-                    const vector<const SymbolicPred*>& constraints,
-		    map<var_t,value_t>* soln);
-
-  static bool ReadSolutionFromFileOrDie(const string& file,
-                                        map<var_t,value_t>* soln);
+  YicesSolver();
+  virtual ~YicesSolver();
+
+  virtual const char* name() const { return "yices"; }
+
+  virtual void Reset(const map<var_t,type_t>& vars);
+  virtual void Push();
+  virtual void Pop();
+  virtual void Assert(const SymbolicPred& pred);
+  virtual solve_result_t Check(map<var_t,value_t>* soln);
+
+ private:
+  yices_context ctx_;
+  yices_expr zero_;
+  map<var_t,yices_var_decl> x_decl_;
+  map<var_t,yices_expr> x_expr_;
 };
 
 }  // namespace crest
@@ -0,0 +1,149 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utility>
+
+#include "base/z3_solver.h"
+
+using std::make_pair;
+
+namespace crest {
+
+Z3Solver::Z3Solver() : ctx_(NULL), solver_(NULL), int_sort_(NULL) { }
+
+Z3Solver::~Z3Solver() {
+  if (ctx_) {
+    Z3_solver_dec_ref(ctx_, solver_);
+    Z3_del_context(ctx_);
+  }
+}
+
+
+Z3_ast Z3Solver::MakeNum(const char* val) {
+  return Z3_mk_numeral(ctx_, val, int_sort_);
+}
+
+
+Z3_ast Z3Solver::MakeNum(value_t val) {
+  return Z3_mk_int64(ctx_, val, int_sort_);
+}
+
+
+void Z3Solver::Reset(const map<var_t,type_t>& vars) {
+  typedef map<var_t,type_t>::const_iterator VarIt;
+
+  // A fresh context per query, so that no terms accumulate across
+  // queries.
+  if (ctx_) {
+    Z3_solver_dec_ref(ctx_, solver_);
+    Z3_del_context(ctx_);
+  }
+  x_expr_.clear();
+
+  Z3_config cfg = Z3_mk_config();
+  ctx_ = Z3_mk_context(cfg);
+  Z3_del_config(cfg);
+  assert(ctx_);
+
+  solver_ = Z3_mk_solver(ctx_);
+  Z3_solver_inc_ref(ctx_, solver_);
+  if (timeout() > 0) {
+    Z3_params params = Z3_mk_params(ctx_);
+    Z3_params_inc_ref(ctx_, params);
+    Z3_params_set_uint(ctx_, params, Z3_mk_string_symbol(ctx_, "timeout"),
+                       static_cast<unsigned>(timeout() * 1000));
+    Z3_solver_set_params(ctx_, solver_, params);
+    Z3_params_dec_ref(ctx_, params);
+  }
+
+  int_sort_ = Z3_mk_int_sort(ctx_);
+
+  // Variable declarations, bounded by the limits of their types.
+  for (VarIt i = vars.begin(); i != vars.end(); ++i) {
+    char buff[32];
+    snprintf(buff, sizeof(buff), "x%d", i->first);
+    Z3_ast x = Z3_mk_const(ctx_, Z3_mk_string_symbol(ctx_, buff), int_sort_);
+    x_expr_[i->first] = x;
+    Z3_solver_assert(ctx_, solver_,
+                     Z3_mk_ge(ctx_, x, MakeNum(kMinValueStr[i->second])));
+    Z3_solver_assert(ctx_, solver_,
+                     Z3_mk_le(ctx_, x, MakeNum(kMaxValueStr[i->second])));
+  }
+}
+
+
+void Z3Solver::Push() {
+  Z3_solver_push(ctx_, solver_);
+}
+
+
+void Z3Solver::Pop() {
+  Z3_solver_pop(ctx_, solver_, 1);
+}
+
+
+void Z3Solver::Assert(const SymbolicPred& pred) {
+  const SymbolicExpr& se = pred.expr();
+  vector<Z3_ast> terms;
+  terms.push_back(MakeNum(se.const_term()));
+  for (SymbolicExpr::TermIt j = se.terms().begin(); j != se.terms().end(); ++j) {
+    Z3_ast prod[2] = { x_expr_[j->first], MakeNum(j->second) };
+    terms.push_back(Z3_mk_mul(ctx_, 2, prod));
+  }
+  Z3_ast e = Z3_mk_add(ctx_, terms.size(), &terms.front());
+  Z3_ast zero = MakeNum(static_cast<value_t>(0));
+
+  Z3_ast p;
+  switch (pred.op()) {
+  case ops::EQ:  p = Z3_mk_eq(ctx_, e, zero); break;
+  case ops::NEQ: p = Z3_mk_not(ctx_, Z3_mk_eq(ctx_, e, zero)); break;
+  case ops::GT:  p = Z3_mk_gt(ctx_, e, zero); break;
+  case ops::LE:  p = Z3_mk_le(ctx_, e, zero); break;
+  case ops::LT:  p = Z3_mk_lt(ctx_, e, zero); break;
+  case ops::GE:  p = Z3_mk_ge(ctx_, e, zero); break;
+  default:
+    fprintf(stderr, "Unknown comparison operator: %d\n", pred.op());
+    exit(1);
+  }
+  Z3_solver_assert(ctx_, solver_, p);
+}
+
+
+solve_result_t Z3Solver::Check(map<var_t,value_t>* soln) {
+  typedef map<var_t,Z3_ast>::const_iterator VarIt;
+
+  Z3_lbool res = Z3_solver_check(ctx_, solver_);
+  if (res == Z3_L_FALSE)
+    return results::UNSAT;
+  if (res == Z3_L_UNDEF)
+    return results::UNKNOWN;
+
+  {
+    soln->clear();
+    Z3_model model = Z3_solver_get_model(ctx_, solver_);
+    Z3_model_inc_ref(ctx_, model);
+    for (VarIt i = x_expr_.begin(); i != x_expr_.end(); ++i) {
+      Z3_ast val;
+      int64_t v = 0;
+      bool ok = (Z3_model_eval(ctx_, model, i->second, true, &val)
+                 && Z3_get_numeral_int64(ctx_, val, &v));
+      assert(ok);
+      soln->insert(make_pair(i->first, static_cast<value_t>(v)));
+    }
+    Z3_model_dec_ref(ctx_, model);
+  }
+
+  return results::SAT;
+}
+
+}  // namespace crest
@@ -0,0 +1,55 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef BASE_Z3_SOLVER_H__
+#define BASE_Z3_SOLVER_H__
+
+#include <map>
+#include <vector>
+#include <z3.h>
+
+#include "base/basic_types.h"
+#include "base/solver.h"
+#include "base/symbolic_predicate.h"
+
+using std::map;
+using std::vector;
+
+namespace crest {
+
+// Solver backend for the Z3 C API.  (Only built when Z3_DIR is set in
+// the Makefile.)
+class Z3Solver : public Solver {
+ public:
+  Z3Solver();
+  virtual ~Z3Solver();
+
+  virtual const char* name() const { return "z3"; }
+
+  virtual void Reset(const map<var_t,type_t>& vars);
+  virtual void Push();
+  virtual void Pop();
+  virtual void Assert(const SymbolicPred& pred);
+  virtual solve_result_t Check(map<var_t,value_t>* soln);
+  virtual bool SupportsTimeout() const { return true; }
+
+ private:
+  Z3_context ctx_;
+  Z3_solver solver_;
+  Z3_sort int_sort_;
+  map<var_t,Z3_ast> x_expr_;
+
+  Z3_ast MakeNum(const char* val);
+  Z3_ast MakeNum(value_t val);
+};
+
+}  // namespace crest
+
+#endif  // BASE_Z3_SOLVER_H__
@@ -10,6 +10,7 @@
 
 #include <assert.h>
 #include <fstream>
+#include <stdlib.h>
 #include <string>
 #include <sys/time.h>
 #include <vector>
@@ -28,6 +29,19 @@ static SymbolicInterpreter* SI;
 // reached by the execution path.
 static int pre_symbolic;
 
+// In coverage-only mode (if CREST_COVERAGE_ONLY is set in the
+// environment), we stay in the "pre-symbolic" mode for the entire run,
+// recording only the branches taken and the inputs.
+static int coverage_only;
+
+// The files from which we read the input, and to which we write the
+// execution, may be overridden by setting CREST_INPUT and
+// CREST_EXECUTION in the environment.
+static const char* FileFromEnv(const char* var, const char* file) {
+  const char* value = getenv(var);
+  return value ? value : file;
+}
+
 // Tables for converting from operators defined in libcrest/crest.h to
 // those defined in base/basic_types.h.
 static const int kOpTable[] =
@@ -57,7 +71,7 @@ void __CrestInit() {
 
   // Read the input.
   vector<value_t> input;
-  std::ifstream in("input");
+  std::ifstream in(FileFromEnv("CREST_INPUT", "input"));
   value_t val;
   while (in >> val) {
     input.push_back(val);
@@ -67,6 +81,7 @@ void __CrestInit() {
   SI = new SymbolicInterpreter(input);
 
   pre_symbolic = 1;
+  coverage_only = (getenv("CREST_COVERAGE_ONLY") != NULL);
 
   assert(!atexit(__CrestAtExit));
 }
@@ -75,11 +90,12 @@ void __CrestInit() {
 void __CrestAtExit() {
   const SymbolicExecution& ex = SI->execution();
 
-  // Write the execution out to file 'szd_execution'.
+  // Write the execution out to file 'szd_execution' (by default).
   string buff;
   buff.reserve(1<<26);
   ex.Serialize(&buff);
-  std::ofstream out("szd_execution", std::ios::out | std::ios::binary);
+  std::ofstream out(FileFromEnv("CREST_EXECUTION", "szd_execution"),
+                    std::ios::out | std::ios::binary);
   out.write(buff.data(), buff.size());
   assert(!out.fail());
   out.close();
@@ -161,31 +177,31 @@ void __CrestHandleReturn(__CREST_ID id, __CREST_VALUE val) {
 //
 
 void __CrestUChar(unsigned char* x) {
-  pre_symbolic = 0;
+  pre_symbolic = coverage_only;
   *x = (unsigned char)SI->NewInput(types::U_CHAR, (addr_t)x);
 }
 
 void __CrestUShort(unsigned short* x) {
-  pre_symbolic = 0;
+  pre_symbolic = coverage_only;
   *x = (unsigned short)SI->NewInput(types::U_SHORT, (addr_t)x);
 }
 
 void __CrestUInt(unsigned int* x) {
-  pre_symbolic = 0;
+  pre_symbolic = coverage_only;
   *x = (unsigned int)SI->NewInput(types::U_INT, (addr_t)x);
 }
 
 void __CrestChar(char* x) {
-  pre_symbolic = 0;
+  pre_symbolic = coverage_only;
   *x = (char)SI->NewInput(types::CHAR, (addr_t)x);
 }
 
 void __CrestShort(short* x) {
-  pre_symbolic = 0;
+  pre_symbolic = coverage_only;
   *x = (short)SI->NewInput(types::SHORT, (addr_t)x);
 }
 
 void __CrestInt(int* x) {
-  pre_symbolic = 0;
+  pre_symbolic = coverage_only;
   *x = (int)SI->NewInput(types::INT, (addr_t)x);
 }
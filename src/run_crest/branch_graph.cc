@@ -0,0 +1,232 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <assert.h>
+#include <fcntl.h>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "run_crest/branch_graph.h"
+
+using std::ifstream;
+using std::ios;
+
+namespace crest {
+
+namespace {
+
+const char kCacheMagic[8] = { 'C', 'R', 'E', 'S', 'T', 'C', 'S', 'R' };
+const unsigned int kCacheVersion = 2;
+
+struct CacheHeader {
+  char magic[8];
+  unsigned int version;
+  unsigned int num_nodes;
+  unsigned long long num_edges;
+  unsigned long long cfg_size;
+  long long cfg_mtime;
+};
+
+size_t CacheLength(size_t num_nodes, size_t num_edges) {
+  return (sizeof(CacheHeader)
+          + 2 * (num_nodes + 1) * sizeof(unsigned int)
+          + 2 * num_edges * sizeof(branch_id_t));
+}
+
+template <typename T>
+bool WriteArray(FILE* f, const vector<T>& v) {
+  return v.empty() || (fwrite(&v.front(), sizeof(T), v.size(), f) == v.size());
+}
+
+}  // namespace
+
+
+BranchGraph::BranchGraph()
+  : num_nodes_(0), num_edges_(0),
+    succ_off_(NULL), succ_(NULL), pred_off_(NULL), pred_(NULL),
+    map_(NULL), map_len_(0) { }
+
+
+BranchGraph::~BranchGraph() {
+  if (map_)
+    munmap(map_, map_len_);
+}
+
+
+void BranchGraph::LoadOrDie(const string& cfg_file, const string& cache_file,
+                            const vector<branch_id_t>& ids,
+                            branch_id_t num_nodes) {
+  assert(!succ_off_);
+  num_nodes_ = num_nodes;
+
+  struct stat st;
+  if (stat(cfg_file.c_str(), &st) != 0) {
+    fprintf(stderr, "Failed to stat %s.\n", cfg_file.c_str());
+    perror("Error: ");
+    exit(-1);
+  }
+
+  if (MapCache(cache_file, st.st_size, st.st_mtime))
+    return;
+
+  BuildOrDie(cfg_file, ids);
+  WriteCache(cache_file, st.st_size, st.st_mtime);
+}
+
+
+bool BranchGraph::MapCache(const string& cache_file,
+                           unsigned long long cfg_size, long long cfg_mtime) {
+  int fd = open(cache_file.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if ((fstat(fd, &st) != 0)
+      || (static_cast<size_t>(st.st_size) < sizeof(CacheHeader))) {
+    close(fd);
+    return false;
+  }
+  size_t len = st.st_size;
+  void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  const CacheHeader* h = static_cast<const CacheHeader*>(map);
+  if (memcmp(h->magic, kCacheMagic, sizeof(kCacheMagic))
+      || (h->version != kCacheVersion)
+      || (h->num_nodes != static_cast<unsigned int>(num_nodes_))
+      || (h->cfg_size != cfg_size)
+      || (h->cfg_mtime != cfg_mtime)
+      || (len != CacheLength(h->num_nodes, h->num_edges))) {
+    munmap(map, len);
+    return false;
+  }
+
+  map_ = map;
+  map_len_ = len;
+  num_edges_ = h->num_edges;
+  succ_off_ = reinterpret_cast<const unsigned int*>(h + 1);
+  succ_ = reinterpret_cast<const branch_id_t*>(succ_off_ + num_nodes_ + 1);
+  pred_off_ = reinterpret_cast<const unsigned int*>(succ_ + num_edges_);
+  pred_ = reinterpret_cast<const branch_id_t*>(pred_off_ + num_nodes_ + 1);
+  return true;
+}
+
+
+void BranchGraph::BuildOrDie(const string& cfg_file,
+                             const vector<branch_id_t>& ids) {
+  ifstream in(cfg_file.c_str(), ios::in | ios::binary);
+  if (!in) {
+    fprintf(stderr, "Failed to open %s.\n", cfg_file.c_str());
+    exit(-1);
+  }
+
+  // Read the adjacency lists, one after another, into the successor
+  // array, counting the out- and in-degree of each node as we go.
+  succ_off_buf_.assign(num_nodes_ + 1, 0);
+  pred_off_buf_.assign(num_nodes_ + 1, 0);
+  vector<branch_id_t> srcs;
+  vector<branch_id_t> dsts;
+  size_t num_branches = 0;
+  in.read((char*)&num_branches, sizeof(num_branches));
+  for (size_t i = 0; i < num_branches; i++) {
+    branch_id_t src;
+    size_t len;
+    in.read((char*)&src, sizeof(src));
+    in.read((char*)&len, sizeof(len));
+    if (!in || (src < 0) || (static_cast<size_t>(src) >= ids.size())
+        || (ids[src] <= 0) || (ids[src] >= num_nodes_)) {
+      fprintf(stderr, "Malformed %s.\n", cfg_file.c_str());
+      exit(-1);
+    }
+    src = ids[src];
+    size_t start = dsts.size();
+    dsts.resize(start + len);
+    if (len > 0)
+      in.read((char*)&dsts[start], len * sizeof(branch_id_t));
+    for (size_t j = start; j < dsts.size(); j++) {
+      if ((dsts[j] < 0) || (static_cast<size_t>(dsts[j]) >= ids.size())
+          || (ids[dsts[j]] <= 0) || (ids[dsts[j]] >= num_nodes_)) {
+        fprintf(stderr, "Malformed %s.\n", cfg_file.c_str());
+        exit(-1);
+      }
+      dsts[j] = ids[dsts[j]];
+      pred_off_buf_[dsts[j] + 1]++;
+    }
+    srcs.resize(start + len, src);
+    succ_off_buf_[src + 1] += len;
+  }
+  if (!in) {
+    fprintf(stderr, "Malformed %s.\n", cfg_file.c_str());
+    exit(-1);
+  }
+  in.close();
+
+  // Turn the degrees into offsets, and place each edge in both
+  // directions.  ('srcs' holds the source of each edge in 'dsts'.)
+  for (branch_id_t b = 0; b < num_nodes_; b++) {
+    succ_off_buf_[b + 1] += succ_off_buf_[b];
+    pred_off_buf_[b + 1] += pred_off_buf_[b];
+  }
+  num_edges_ = dsts.size();
+  succ_buf_.resize(num_edges_);
+  pred_buf_.resize(num_edges_);
+  vector<unsigned int> succ_pos(succ_off_buf_.begin(), succ_off_buf_.end() - 1);
+  vector<unsigned int> pred_pos(pred_off_buf_.begin(), pred_off_buf_.end() - 1);
+  for (size_t e = 0; e < num_edges_; e++) {
+    succ_buf_[succ_pos[srcs[e]]++] = dsts[e];
+    pred_buf_[pred_pos[dsts[e]]++] = srcs[e];
+  }
+
+  succ_off_ = &succ_off_buf_.front();
+  pred_off_ = &pred_off_buf_.front();
+  succ_ = succ_buf_.empty() ? NULL : &succ_buf_.front();
+  pred_ = pred_buf_.empty() ? NULL : &pred_buf_.front();
+}
+
+
+void BranchGraph::WriteCache(const string& cache_file,
+                             unsigned long long cfg_size,
+                             long long cfg_mtime) const {
+  CacheHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, kCacheMagic, sizeof(kCacheMagic));
+  h.version = kCacheVersion;
+  h.num_nodes = num_nodes_;
+  h.num_edges = num_edges_;
+  h.cfg_size = cfg_size;
+  h.cfg_mtime = cfg_mtime;
+
+  // Written to a temporary file and renamed into place, so that a
+  // partial cache is never mapped.  (Failing to write the cache only
+  // costs the next run the time to rebuild the graph.)
+  const string tmp = cache_file + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "wb");
+  bool ok = (f != NULL);
+  if (ok) {
+    ok = ((fwrite(&h, sizeof(h), 1, f) == 1)
+          && WriteArray(f, succ_off_buf_)
+          && WriteArray(f, succ_buf_)
+          && WriteArray(f, pred_off_buf_)
+          && WriteArray(f, pred_buf_));
+    ok = (fclose(f) == 0) && ok;
+  }
+  if (!ok || rename(tmp.c_str(), cache_file.c_str())) {
+    fprintf(stderr, "Failed to write %s.\n", cache_file.c_str());
+    unlink(tmp.c_str());
+  }
+}
+
+}  // namespace crest
@@ -0,0 +1,91 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef RUN_CREST_BRANCH_GRAPH_H__
+#define RUN_CREST_BRANCH_GRAPH_H__
+
+#include <string>
+#include <vector>
+
+#include "base/basic_types.h"
+
+using std::string;
+using std::vector;
+
+namespace crest {
+
+//
+// The (thinned) control-flow graph between branches, as written to
+// "cfg_branches" by process_cfg, in compressed sparse row form: for each
+// direction, one array of offsets (indexed by branch id) into one array
+// of neighbors.
+//
+// The graph is built in one pass over "cfg_branches", and then saved to
+// a cache file, which later runs map into memory directly (as long as it
+// was built from the same "cfg_branches").  The cache holds, as native
+// 32- and 64-bit integers:
+//   the magic string "CRESTCSR", a version, and the number of nodes;
+//   the number of edges;
+//   the size and modification time of "cfg_branches";
+//   the successor offsets and successors;
+//   the predecessor offsets and predecessors.
+//
+class BranchGraph {
+ public:
+  typedef const branch_id_t* NbhrIt;
+
+  BranchGraph();
+  ~BranchGraph();
+
+  // Loads the graph on nodes [0, num_nodes) from 'cache_file' if it is
+  // up to date, or else from 'cfg_file' (writing 'cache_file').  The
+  // branch ids in 'cfg_file' are translated to nodes by 'ids'.
+  void LoadOrDie(const string& cfg_file, const string& cache_file,
+                 const vector<branch_id_t>& ids, branch_id_t num_nodes);
+
+  NbhrIt succ_begin(branch_id_t b) const { return succ_ + succ_off_[b]; }
+  NbhrIt succ_end(branch_id_t b) const { return succ_ + succ_off_[b+1]; }
+  NbhrIt pred_begin(branch_id_t b) const { return pred_ + pred_off_[b]; }
+  NbhrIt pred_end(branch_id_t b) const { return pred_ + pred_off_[b+1]; }
+
+  size_t num_edges() const { return num_edges_; }
+
+ private:
+  branch_id_t num_nodes_;
+  size_t num_edges_;
+
+  // Either into the arrays below, or into the mapped cache file.
+  const unsigned int* succ_off_;
+  const branch_id_t* succ_;
+  const unsigned int* pred_off_;
+  const branch_id_t* pred_;
+
+  vector<unsigned int> succ_off_buf_;
+  vector<branch_id_t> succ_buf_;
+  vector<unsigned int> pred_off_buf_;
+  vector<branch_id_t> pred_buf_;
+
+  void* map_;
+  size_t map_len_;
+
+  bool MapCache(const string& cache_file,
+                unsigned long long cfg_size, long long cfg_mtime);
+  void BuildOrDie(const string& cfg_file, const vector<branch_id_t>& ids);
+  void WriteCache(const string& cache_file,
+                  unsigned long long cfg_size, long long cfg_mtime) const;
+
+  // Not copyable.
+  BranchGraph(const BranchGraph&);
+  BranchGraph& operator=(const BranchGraph&);
+};
+
+}  // namespace crest
+
+#endif  // RUN_CREST_BRANCH_GRAPH_H__
@@ -0,0 +1,92 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <assert.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "run_crest/branch_set.h"
+
+namespace crest {
+
+void BranchSet::Resize(size_t n) {
+  // Clear any bits beyond the old size, in the last old word.
+  if ((n > size_) && (size_ % kWordBits != 0)) {
+    words_.back() &= (static_cast<word_t>(1) << (size_ % kWordBits)) - 1;
+  }
+  words_.resize((n + kWordBits - 1) / kWordBits, 0);
+  size_ = n;
+}
+
+
+void BranchSet::Clear() {
+  if (!words_.empty())
+    memset(&words_.front(), 0, words_.size() * sizeof(word_t));
+}
+
+
+size_t BranchSet::Count() const {
+  size_t n = 0;
+  for (size_t i = 0; i < words_.size(); i++) {
+    n += __builtin_popcountll(words_[i]);
+  }
+  return n;
+}
+
+
+void BranchSet::Union(const BranchSet& bs) {
+  assert(bs.size_ == size_);
+  const size_t n = words_.size();
+  size_t i = 0;
+#ifdef __SSE2__
+  // Two words at a time.
+  for (; i + 2 <= n; i += 2) {
+    __m128i* dst = reinterpret_cast<__m128i*>(&words_[i]);
+    const __m128i* src = reinterpret_cast<const __m128i*>(&bs.words_[i]);
+    _mm_storeu_si128(dst, _mm_or_si128(_mm_loadu_si128(dst),
+                                       _mm_loadu_si128(src)));
+  }
+#endif
+  for (; i < n; i++) {
+    words_[i] |= bs.words_[i];
+  }
+}
+
+
+void BranchSet::Difference(const BranchSet& bs,
+                           vector<branch_id_t>* ids) const {
+  assert(bs.size_ == size_);
+  for (size_t i = 0; i < words_.size(); i++) {
+    for (word_t w = words_[i] & ~bs.words_[i]; w; w &= w - 1) {
+      ids->push_back(i * kWordBits + __builtin_ctzll(w));
+    }
+  }
+}
+
+
+void BranchSet::Write(ostream& out) const {
+  if (!words_.empty())
+    out.write((const char*)&words_.front(), words_.size() * sizeof(word_t));
+}
+
+
+bool BranchSet::Read(istream& in, size_t n) {
+  words_.assign((n + kWordBits - 1) / kWordBits, 0);
+  size_ = n;
+  if (!words_.empty())
+    in.read((char*)&words_.front(), words_.size() * sizeof(word_t));
+  if (size_ % kWordBits != 0)
+    words_.back() &= (static_cast<word_t>(1) << (size_ % kWordBits)) - 1;
+  return !in.fail();
+}
+
+}  // namespace crest
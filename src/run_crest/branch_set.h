@@ -0,0 +1,74 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef RUN_CREST_BRANCH_SET_H__
+#define RUN_CREST_BRANCH_SET_H__
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "base/basic_types.h"
+
+using std::istream;
+using std::ostream;
+using std::vector;
+
+namespace crest {
+
+//
+// A set of (dense) branch ids, as a bitset packed into 64-bit words, so
+// that sets can be counted and merged a word at a time.
+//
+class BranchSet {
+ public:
+  BranchSet() : size_(0) { }
+  explicit BranchSet(size_t n) : size_(0) { Resize(n); }
+
+  // Resizes the set to hold ids [0, n), with any new ids not in the set.
+  void Resize(size_t n);
+
+  // Empties the set.
+  void Clear();
+
+  size_t size() const { return size_; }
+
+  bool operator[](size_t i) const {
+    return (words_[i / kWordBits] >> (i % kWordBits)) & 1;
+  }
+  void Set(size_t i) {
+    words_[i / kWordBits] |= (static_cast<word_t>(1) << (i % kWordBits));
+  }
+
+  // The number of ids in the set.
+  size_t Count() const;
+
+  // Adds all of the ids in 'bs' (which must be the same size) to the set.
+  void Union(const BranchSet& bs);
+
+  // Appends to 'ids' the ids in the set but not in 'bs' (which must be
+  // the same size), in increasing order.
+  void Difference(const BranchSet& bs, vector<branch_id_t>* ids) const;
+
+  // Writes or reads the set (of 'n' ids), as native 64-bit words.
+  void Write(ostream& out) const;
+  bool Read(istream& in, size_t n);
+
+ private:
+  typedef unsigned long long word_t;
+  static const size_t kWordBits = 64;
+
+  vector<word_t> words_;
+  size_t size_;
+};
+
+}  // namespace crest
+
+#endif  // RUN_CREST_BRANCH_SET_H__
@@ -11,27 +11,42 @@
 #include <algorithm>
 #include <assert.h>
 #include <cmath>
+#include <errno.h>
 #include <fstream>
 #include <functional>
 #include <limits>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 #include <queue>
+#include <typeinfo>
+#include <unistd.h>
 #include <utility>
 
-#include "base/yices_solver.h"
 #include "run_crest/concolic_search.h"
 
 using std::binary_function;
+using std::find;
+using std::greater;
 using std::ifstream;
 using std::ios;
+using std::ofstream;
+using std::make_pair;
 using std::min;
 using std::max;
+using std::max_element;
+using std::lower_bound;
 using std::numeric_limits;
 using std::pair;
+using std::priority_queue;
 using std::queue;
 using std::random_shuffle;
 using std::stable_sort;
+using std::unique;
 
 namespace crest {
 
@@ -39,6 +54,13 @@ namespace {
 
 typedef pair<size_t,int> ScoredBranch;
 
+// A call frame along a path (see CfgHeuristicSearch::ReturnDistances).
+struct CallFrame {
+  function_id_t fid;
+  branch_id_t last;
+  size_t ret_dist;
+};
+
 struct ScoredBranchComp
   : public binary_function<ScoredBranch, ScoredBranch, bool>
 {
@@ -47,6 +69,119 @@ struct ScoredBranchComp
   }
 };
 
+// (Orders ranked branches by rate alone -- see Search::RankBranches.)
+struct RateComp {
+  bool operator()(const pair<double,ScoredBranch>& a,
+                  const pair<double,ScoredBranch>& b) const {
+    return (a.first < b.first);
+  }
+};
+
+// Limits on the retrying of timed-out solver queries.
+const size_t kMaxTimedOutQueries = 1000;
+const int kMaxSolveAttempts = 4;
+
+// How long to run before enforcing the cap on the solver's share of
+// the running time.
+const time_t kMinSolverShareTime = 10;
+
+// The default limit on the memory used by the execution tree, in
+// megabytes.
+const size_t kDefaultTreeMemory = 256;
+
+double WallTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+// A hash of the branches taken along a path.
+size_t PathHash(const SymbolicPath& path) {
+  // (FNV-1a.)
+  unsigned long long h = 14695981039346656037ULL;
+  const vector<branch_id_t>& bs = path.branches();
+  for (size_t i = 0; i < bs.size(); i++) {
+    h = (h ^ static_cast<unsigned int>(bs[i])) * 1099511628211ULL;
+  }
+  return static_cast<size_t>(h);
+}
+
+// (Roughly) the memory used by the path of an execution.
+size_t PathMemory(const SymbolicPath& path) {
+  // (Allowing for the map nodes which hold the terms of each constraint.)
+  const size_t kTermMemory = 48;
+  size_t bytes = (path.branches().size() * sizeof(branch_id_t)
+                  + path.constraints_idx().size() * sizeof(size_t)
+                  + path.constraints().size() * sizeof(SymbolicPred*));
+  // (Not counting the constraints shared with another path.)
+  for (size_t i = path.num_shared_constraints();
+       i < path.constraints().size(); i++) {
+    bytes += (sizeof(SymbolicPred) + sizeof(SymbolicExpr)
+              + path.constraints()[i]->expr().terms().size() * kTermMemory);
+  }
+  return bytes;
+}
+
+// The peak memory used by this process, in megabytes.
+size_t PeakMemory() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss / 1024;
+}
+
+// Checkpoint files start with a magic number and version, followed by
+// the name of the strategy which wrote them.
+const char kCheckpointMagic[] = "CRESTCKP";
+const int kCheckpointVersion = 6;
+
+template <typename T>
+void WriteValue(ostream& out, const T& x) {
+  out.write((const char*)&x, sizeof(x));
+}
+
+template <typename T>
+bool ReadValue(istream& in, T* x) {
+  in.read((char*)x, sizeof(*x));
+  return !in.fail();
+}
+
+void WriteString(ostream& out, const string& s) {
+  WriteValue(out, s.size());
+  out.write(s.data(), s.size());
+}
+
+bool ReadString(istream& in, string* s) {
+  size_t len;
+  if (!ReadValue(in, &len))
+    return false;
+  s->resize(len);
+  if (len > 0)
+    in.read(&(*s)[0], len);
+  return !in.fail();
+}
+
+void WriteInput(ostream& out, const vector<value_t>& input) {
+  WriteValue(out, input.size());
+  if (!input.empty())
+    out.write((const char*)&input.front(), input.size() * sizeof(value_t));
+}
+
+bool ReadInput(istream& in, vector<value_t>* input) {
+  size_t len;
+  if (!ReadValue(in, &len))
+    return false;
+  input->resize(len);
+  if (len > 0)
+    in.read((char*)&input->front(), len * sizeof(value_t));
+  return !in.fail();
+}
+
+void WriteExecution(ostream& out, const SymbolicExecution& ex) {
+  string s;
+  ex.Serialize(&s);
+  out.write(s.data(), s.size());
+}
+
 }  // namespace
 
 
@@ -55,14 +190,29 @@ struct ScoredBranchComp
 ////////////////////////////////////////////////////////////////////////
 
 Search::Search(const string& program, int max_iterations)
-  : program_(program), max_iters_(max_iterations), num_iters_(0) {
+  : tree_(paired_branch_),
+    program_(program), max_iters_(max_iterations), num_iters_(0),
+    max_time_(0), max_solver_time_(0), max_memory_(0),
+    stop_reason_(NULL), last_target_iter_(-1), last_target_time_(0),
+    slice_end_(numeric_limits<int>::max()),
+    program_time_(0),
+    solver_(Solver::Create("yices")), solver_pool_(new SolverPool(solver_, 0)),
+    solver_timeout_(0), max_solver_share_(1), num_skipped_solves_(0),
+    max_frontier_memory_(numeric_limits<size_t>::max()),
+    frontier_memory_used_(0),
+    num_reexecutions_(0), num_reexecutions_diverged_(0),
+    corpus_(NULL), checkpoint_interval_(0), rng_seed_(0) {
 
   start_time_ = time(NULL);
+  last_checkpoint_ = start_time_;
+  num_targets_hit_ = 0;
+  SetMaxTreeMemory(kDefaultTreeMemory);
 
   { // Read in the set of branches.
-    max_branch_ = 0;
+    branch_id_t max_raw_branch = 0;
     max_function_ = 0;
-    branches_.reserve(100000);
+    raw_branch_.reserve(100000);
+    raw_branch_.push_back(0);  // (Dense ids start at 1.)
     branch_count_.reserve(100000);
     branch_count_.push_back(0);
 
@@ -75,14 +225,22 @@ Search::Search(const string& program, int max_iterations)
       branch_id_t b1, b2;
       for (int i = 0; i < numBranches; i++) {
 	assert(in >> b1 >> b2);
-	branches_.push_back(b1);
-	branches_.push_back(b2);
-	max_branch_ = max(max_branch_, max(b1, b2));
+	raw_branch_.push_back(b1);
+	raw_branch_.push_back(b2);
+	max_raw_branch = max(max_raw_branch, max(b1, b2));
       }
     }
     in.close();
-    max_branch_ ++;
     max_function_ = branch_count_.size();
+
+    // Number the branches densely.
+    max_branch_ = raw_branch_.size();
+    dense_branch_.resize(max_raw_branch + 1, 0);
+    branches_.reserve(max_branch_ - 1);
+    for (branch_id_t b = 1; b < max_branch_; b++) {
+      dense_branch_[raw_branch_[b]] = b;
+      branches_.push_back(b);
+    }
   }
 
   // Compute the paired-branch map.
@@ -105,16 +263,19 @@ Search::Search(const string& program, int max_iterations)
   // Initialize all branches to "uncovered" (and functions to "unreached").
   total_num_covered_ = num_covered_ = 0;
   reachable_functions_ = reachable_branches_ = 0;
-  covered_.resize(max_branch_, false);
-  total_covered_.resize(max_branch_, false);
+  covered_.Resize(max_branch_);
+  total_covered_.Resize(max_branch_);
+  BranchOutcomes none = { 0, 0, 0, 0, 0, 0 };
+  outcomes_.assign(max_branch_, none);
   reached_.resize(max_function_, false);
 
 #if 0
   { // Read in any previous coverage (for faster debugging).
     ifstream in("coverage");
-    branch_id_t bid;
-    while (in >> bid) {
-      covered_[bid] = true;
+    branch_id_t raw_bid;
+    while (in >> raw_bid) {
+      branch_id_t bid = dense_branch_[raw_bid];
+      covered_.Set(bid);
       num_covered_ ++;
       if (!reached_[branch_function_[bid]]) {
 	reached_[branch_function_[bid]] = true;
@@ -137,7 +298,440 @@ Search::Search(const string& program, int max_iterations)
 }
 
 
-Search::~Search() { }
+Search::~Search() {
+  for (size_t i = 0; i < timed_out_.size(); i++)
+    delete timed_out_[i].ex;
+  delete solver_pool_;
+  delete solver_;
+  delete corpus_;
+}
+
+
+void Search::SetSolverWorkers(int num_workers) {
+  delete solver_pool_;
+  solver_pool_ = new SolverPool(solver_, num_workers);
+}
+
+
+bool Search::SetSolver(const string& name) {
+  Solver* solver = Solver::Create(name);
+  if (!solver)
+    return false;
+
+  int num_workers = solver_pool_->num_workers();
+  delete solver_pool_;
+  delete solver_;
+  solver_ = solver;
+  solver_->set_dump_dir(query_dump_dir_);
+  solver_pool_ = new SolverPool(solver_, num_workers);
+  return true;
+}
+
+
+void Search::SetSolverTimeout(double seconds) {
+  solver_timeout_ = seconds;
+}
+
+
+void Search::SetQueryDumpDir(const string& dir) {
+  if ((mkdir(dir.c_str(), 0777) != 0) && (errno != EEXIST)) {
+    fprintf(stderr, "Failed to create %s.\n", dir.c_str());
+    perror("Error: ");
+    exit(-1);
+  }
+  query_dump_dir_ = dir;
+  solver_->set_dump_dir(dir);
+}
+
+
+void Search::SetMaxSolverShare(double share) {
+  max_solver_share_ = share;
+}
+
+
+void Search::SetMaxTime(double seconds) {
+  max_time_ = seconds;
+}
+
+
+void Search::SetMaxSolverTime(double seconds) {
+  max_solver_time_ = seconds;
+}
+
+
+void Search::SetMaxMemory(size_t megabytes) {
+  max_memory_ = megabytes;
+}
+
+
+void Search::SetMaxTreeMemory(size_t megabytes) {
+  tree_.set_max_memory(megabytes << 20);
+}
+
+
+void Search::SetFrontierMemory(size_t megabytes) {
+  max_frontier_memory_ = megabytes << 20;
+}
+
+
+void Search::SetCorpusDir(const string& dir) {
+  delete corpus_;
+  corpus_ = new Corpus(dir);
+  corpus_dir_ = dir;
+}
+
+
+bool Search::SetTargets(const vector<branch_id_t>& ids) {
+  targets_.clear();
+  is_target_.Resize(max_branch_);
+  is_target_.Clear();
+  for (size_t i = 0; i < ids.size(); i++) {
+    if ((ids[i] <= 0) || (static_cast<size_t>(ids[i]) >= dense_branch_.size())
+        || (dense_branch_[ids[i]] == 0))
+      return false;
+    branch_id_t b = dense_branch_[ids[i]];
+    if (!is_target_[b]) {
+      is_target_.Set(b);
+      targets_.push_back(b);
+    }
+  }
+  num_targets_hit_ = 0;
+  for (BranchIt i = targets_.begin(); i != targets_.end(); ++i) {
+    if (total_covered_[*i])
+      num_targets_hit_++;
+  }
+  return true;
+}
+
+
+void Search::Seed(const string& dir, int jobs) {
+  Corpus seeds(dir);
+  const vector<Corpus::Entry>& entries = seeds.entries();
+
+  // Don't add the seeds back to the corpus they came from.
+  Corpus* corpus = corpus_;
+  if (corpus_ && (dir == corpus_dir_))
+    corpus_ = NULL;
+
+  // Each of the 'jobs' concurrent runs has its own input and execution
+  // files.
+  jobs = max(1, jobs);
+  vector<pid_t> running(jobs, 0);
+  vector<size_t> running_entry(jobs);
+  size_t num_running = 0;
+  size_t next = 0;
+  char input_file[32], execution_file[32];
+
+  while (true) {
+    // Start as many runs as we can.
+    for (int j = 0; j < jobs; j++) {
+      if (running[j] || (next == entries.size()) || BudgetExhausted())
+        continue;
+      snprintf(input_file, sizeof(input_file), "input.%d", j);
+      snprintf(execution_file, sizeof(execution_file), "szd_execution.%d", j);
+      WriteInputToFileOrDie(input_file, entries[next].input);
+
+      pid_t pid = fork();
+      if (pid < 0) {
+        perror("Failed to run seed input");
+        exit(-1);
+      }
+      if (pid == 0) {
+        setenv("CREST_INPUT", input_file, 1);
+        setenv("CREST_EXECUTION", execution_file, 1);
+        setenv("CREST_COVERAGE_ONLY", "1", 1);
+        execl("/bin/sh", "sh", "-c", program_.c_str(), (char*)NULL);
+        _exit(127);
+      }
+      running[j] = pid;
+      running_entry[j] = next++;
+      num_running++;
+      num_iters_++;
+    }
+    if (num_running == 0)
+      break;
+
+    // Collect a finished run.  (Only our own runs -- the solver workers
+    // are children of this process, too.)
+    int j = 0;
+    for (;;) {
+      if (running[j]) {
+        int status;
+        pid_t pid = waitpid(running[j], &status, WNOHANG);
+        if (pid < 0) {
+          perror("Error waiting for seed input");
+          exit(-1);
+        }
+        if (pid == running[j])
+          break;
+      }
+      if (++j == jobs) {
+        j = 0;
+        usleep(1000);
+      }
+    }
+    running[j] = 0;
+    num_running--;
+
+    snprintf(execution_file, sizeof(execution_file), "szd_execution.%d", j);
+    SymbolicExecution ex;
+    ifstream in(execution_file, ios::in | ios::binary);
+    if (!in || !ex.Parse(in)) {
+      fprintf(stderr, "Failed to run seed input %zu.\n", running_entry[j]);
+      continue;
+    }
+    in.close();
+    ex.mutable_path()->RemapBranches(dense_branch_);
+
+    unsigned int prev_covered = total_num_covered_;
+    UpdateCoverage(ex);
+    if (total_num_covered_ > prev_covered) {
+      seed_inputs_.push_back(entries[running_entry[j]].input);
+    }
+  }
+
+  for (int j = 0; j < jobs; j++) {
+    snprintf(input_file, sizeof(input_file), "input.%d", j);
+    snprintf(execution_file, sizeof(execution_file), "szd_execution.%d", j);
+    unlink(input_file);
+    unlink(execution_file);
+  }
+  corpus_ = corpus;
+
+  fprintf(stderr, "Seeded with %zu of %zu corpus inputs.\n",
+          seed_inputs_.size(), entries.size());
+}
+
+
+vector<value_t> Search::NextStartingInput() {
+  vector<value_t> input;
+  if (!seed_inputs_.empty()) {
+    input.swap(seed_inputs_.front());
+    seed_inputs_.pop_front();
+  }
+  return input;
+}
+
+
+void Search::SetCheckpointInterval(double seconds) {
+  checkpoint_interval_ = seconds;
+}
+
+
+bool Search::Resume() {
+  ifstream in("checkpoint", ios::in | ios::binary);
+  if (!in)
+    return false;
+
+  char magic[sizeof(kCheckpointMagic)];
+  int version;
+  string strategy;
+  in.read(magic, sizeof(magic));
+  if (in.fail() || memcmp(magic, kCheckpointMagic, sizeof(magic))
+      || !ReadValue(in, &version) || (version != kCheckpointVersion)
+      || !ReadString(in, &strategy)) {
+    fprintf(stderr, "Not a (compatible) CREST checkpoint: checkpoint\n");
+    exit(-1);
+  }
+  if (strategy != typeid(*this).name()) {
+    fprintf(stderr, "Checkpoint was written by a different search strategy.\n");
+    exit(-1);
+  }
+  if (!LoadState(in)) {
+    fprintf(stderr, "Failed to read checkpoint.\n");
+    exit(-1);
+  }
+  in.close();
+
+  fprintf(stderr, "Resumed at iteration %d (%lds): covered %u branches [%u reach funs, %u reach branches].\n",
+	  num_iters_, time(NULL)-start_time_, total_num_covered_, reachable_functions_, reachable_branches_);
+  return true;
+}
+
+
+void Search::Finish() {
+  if (!stop_reason_)
+    stop_reason_ = "search completed";
+
+  WriteCoverageToFileOrDie("coverage");
+  if (checkpoint_interval_ > 0)
+    WriteCheckpoint();
+  if (corpus_)
+    corpus_->Minimize();
+
+  Solver::Stats stats = solver_pool_->stats();
+  stats.Add(other_solver_stats_);
+  const double elapsed = difftime(time(NULL), start_time_);
+  unsigned int num_backed_off = 0;
+  for (size_t i = 0; i < outcomes_.size(); i++) {
+    if (outcomes_[i].failures > 0)
+      num_backed_off++;
+  }
+  char buff[2048];
+  snprintf(buff, sizeof(buff),
+           "Stopped: %s\n"
+           "Iterations: %d\n"
+           "Covered branches: %u/%zu [%u reach funs, %u reach branches]\n"
+           "Time: %.0fs (%.1fs running the program, %.1fs solving, %.1fs other)\n"
+           "Solver queries: %u (%u sat, %u unsat, %u unknown)\n"
+           "Timed-out queries pending: %zu\n"
+           "Execution tree: %zu nodes (%zuKB), %u solver queries skipped\n"
+           "Re-executions of suspended paths: %u (%u diverged)\n"
+           "Backed-off branches: %u\n"
+           "Corpus: %zu inputs\n"
+           "Peak memory: %zuMB\n",
+           stop_reason_, num_iters_,
+           total_num_covered_, branches_.size(),
+           reachable_functions_, reachable_branches_,
+           elapsed, program_time_, stats.solve_time,
+           max(0.0, elapsed - program_time_ - stats.solve_time),
+           stats.num_queries, stats.num_sat, stats.num_unsat, stats.num_unknown,
+           timed_out_.size(),
+           tree_.num_nodes(), tree_.memory() >> 10, num_skipped_solves_,
+           num_reexecutions_, num_reexecutions_diverged_,
+           num_backed_off,
+           (corpus_ ? corpus_->size() : 0), PeakMemory());
+
+  if (!targets_.empty()) {
+    size_t len = strlen(buff);
+    if (last_target_iter_ >= 0) {
+      snprintf(buff + len, sizeof(buff) - len,
+               "Targets hit: %zu/%zu (the last at iteration %d, after %.0fs)\n",
+               num_targets_hit_, targets_.size(),
+               last_target_iter_, last_target_time_);
+    } else {
+      snprintf(buff + len, sizeof(buff) - len, "Targets hit: %zu/%zu\n",
+               num_targets_hit_, targets_.size());
+    }
+  }
+
+  fprintf(stderr, "%s", buff);
+  FILE* f = fopen("report", "w");
+  if (!f) {
+    fprintf(stderr, "Failed to open report.\n");
+    perror("Error: ");
+    exit(-1);
+  }
+  fprintf(f, "%s", buff);
+  fclose(f);
+}
+
+
+void Search::MaybeCheckpoint() {
+  if ((checkpoint_interval_ > 0)
+      && (difftime(time(NULL), last_checkpoint_) >= checkpoint_interval_)) {
+    WriteCheckpoint();
+  }
+}
+
+
+void Search::WriteCheckpoint() {
+  rng_seed_ = rand();
+  srand(rng_seed_);
+
+  // Write to a temporary file first, so that a crash while writing
+  // does not destroy the previous checkpoint.
+  ofstream out("checkpoint.tmp", ios::out | ios::binary | ios::trunc);
+  out.write(kCheckpointMagic, sizeof(kCheckpointMagic));
+  WriteValue(out, kCheckpointVersion);
+  WriteString(out, typeid(*this).name());
+  SaveState(out);
+  out.close();
+  if (out.fail() || rename("checkpoint.tmp", "checkpoint")) {
+    fprintf(stderr, "Failed to write checkpoint.\n");
+    perror("Error: ");
+  }
+  last_checkpoint_ = time(NULL);
+}
+
+
+void Search::SaveState(ostream& out) const {
+  WriteValue(out, max_branch_);
+  WriteValue(out, num_iters_);
+  WriteValue(out, time(NULL) - start_time_);
+  WriteValue(out, rng_seed_);
+
+  covered_.Write(out);
+  total_covered_.Write(out);
+
+  WriteValue(out, timed_out_.size());
+  for (size_t i = 0; i < timed_out_.size(); i++) {
+    WriteValue(out, timed_out_[i].timeout);
+    WriteValue(out, timed_out_[i].attempts);
+    WriteExecution(out, *timed_out_[i].ex);
+  }
+
+  WriteValue(out, seed_inputs_.size());
+  for (size_t i = 0; i < seed_inputs_.size(); i++) {
+    WriteInput(out, seed_inputs_[i]);
+  }
+
+  for (size_t i = 0; i < outcomes_.size(); i++) {
+    WriteValue(out, outcomes_[i]);
+  }
+}
+
+
+bool Search::LoadState(istream& in) {
+  branch_id_t max_branch;
+  time_t elapsed;
+  if (!ReadValue(in, &max_branch) || (max_branch != max_branch_)
+      || !ReadValue(in, &num_iters_) || !ReadValue(in, &elapsed)
+      || !ReadValue(in, &rng_seed_)
+      || !covered_.Read(in, max_branch_)
+      || !total_covered_.Read(in, max_branch_))
+    return false;
+  start_time_ = time(NULL) - elapsed;
+  srand(rng_seed_);
+
+  // Recompute the coverage counts.
+  num_covered_ = covered_.Count();
+  total_num_covered_ = total_covered_.Count();
+  num_targets_hit_ = 0;
+  for (BranchIt i = targets_.begin(); i != targets_.end(); ++i) {
+    if (total_covered_[*i])
+      num_targets_hit_++;
+  }
+  reachable_functions_ = reachable_branches_ = 0;
+  reached_.assign(max_function_, false);
+  for (BranchIt i = branches_.begin(); i != branches_.end(); ++i) {
+    if (total_covered_[*i] && !reached_[branch_function_[*i]]) {
+      reached_[branch_function_[*i]] = true;
+      reachable_functions_ ++;
+      reachable_branches_ += branch_count_[branch_function_[*i]];
+    }
+  }
+
+  size_t n;
+  if (!ReadValue(in, &n))
+    return false;
+  for (size_t i = 0; i < n; i++) {
+    TimedOutQuery q;
+    if (!ReadValue(in, &q.timeout) || !ReadValue(in, &q.attempts))
+      return false;
+    q.ex = new SymbolicExecution();
+    if (!q.ex->Parse(in)) {
+      delete q.ex;
+      return false;
+    }
+    timed_out_.push_back(q);
+  }
+
+  if (!ReadValue(in, &n))
+    return false;
+  seed_inputs_.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    if (!ReadInput(in, &seed_inputs_[i]))
+      return false;
+  }
+
+  for (size_t i = 0; i < outcomes_.size(); i++) {
+    if (!ReadValue(in, &outcomes_[i]))
+      return false;
+  }
+
+  return true;
+}
 
 
 void Search::WriteInputToFileOrDie(const string& file,
@@ -165,11 +759,16 @@ void Search::WriteCoverageToFileOrDie(const string& file) {
     exit(-1);
   }
 
+  vector<branch_id_t> covered;
   for (BranchIt i = branches_.begin(); i != branches_.end(); ++i) {
     if (total_covered_[*i]) {
-      fprintf(f, "%d\n", *i);
+      covered.push_back(raw_branch_[*i]);
     }
   }
+  sort(covered.begin(), covered.end());
+  for (BranchIt i = covered.begin(); i != covered.end(); ++i) {
+    fprintf(f, "%d\n", *i);
+  }
 
   fclose(f);
 }
@@ -192,20 +791,72 @@ void Search::LaunchProgram(const vector<value_t>& inputs) {
 }
 
 
-void Search::RunProgram(const vector<value_t>& inputs, SymbolicExecution* ex) {
-  if (++num_iters_ > max_iters_) {
-    // TODO(jburnim): Devise a better system for capping the iterations.
-    exit(0);
+bool Search::BudgetExhausted() {
+  if (stop_reason_)
+    return true;
+
+  if (tree_.closed()) {
+    stop_reason_ = "all paths explored";
+  } else if (!targets_.empty() && (num_targets_hit_ == targets_.size())) {
+    stop_reason_ = "all targets hit";
+  } else if (num_iters_ >= max_iters_) {
+    stop_reason_ = "iterations";
+  } else if ((max_time_ > 0) && (difftime(time(NULL), start_time_) >= max_time_)) {
+    stop_reason_ = "time";
+  } else if ((max_solver_time_ > 0)
+             && (solver_pool_->stats().solve_time
+                 + other_solver_stats_.solve_time >= max_solver_time_)) {
+    stop_reason_ = "solver time";
+  } else if ((max_memory_ > 0) && (PeakMemory() >= max_memory_)) {
+    stop_reason_ = "memory";
   }
+  return (stop_reason_ != NULL) || (num_iters_ >= slice_end_);
+}
+
+
+bool Search::RunSlice(int iterations) {
+  slice_end_ = num_iters_ + iterations;
+  Run();
+  // (Run returns before the end of its slice only once it is done.)
+  bool more = BudgetExhausted() && !stop_reason_;
+  slice_end_ = numeric_limits<int>::max();
+  return more;
+}
+
+
+size_t Search::ImportCoverage(const Search& other) {
+  vector<branch_id_t> bs;
+  other.total_covered_.Difference(total_covered_, &bs);
+  if (!bs.empty())
+    AddCoverage(bs, NULL);
+  return bs.size();
+}
+
+
+bool Search::RunProgram(const vector<value_t>& inputs, SymbolicExecution* ex) {
+  if (BudgetExhausted()) {
+    // Leave an empty execution, which no strategy will mistake for a
+    // successful run.
+    SymbolicExecution empty;
+    ex->Swap(empty);
+    return false;
+  }
+  num_iters_++;
 
   // Run the program.
+  double start = WallTime();
   LaunchProgram(inputs);
+  double run_time = WallTime() - start;
+  program_time_ += run_time;
 
   // Read the execution from the program.
   // Want to do this with sockets.  (Currently doing it with files.)
   ifstream in("szd_execution", ios::in | ios::binary);
   assert(in && ex->Parse(in));
   in.close();
+  cost_model_.RecordRun(ex->path().branches().size(), run_time);
+  ex->mutable_path()->RemapBranches(dense_branch_);
+  tree_.Insert(ex->path());
 
   /*
   for (size_t i = 0; i < ex->path().branches().size(); i++) {
@@ -213,6 +864,46 @@ void Search::RunProgram(const vector<value_t>& inputs, SymbolicExecution* ex) {
   }
   fprintf(stderr, "\n");
   */
+
+  return true;
+}
+
+
+size_t Search::SuspendExecution(SymbolicExecution* ex, size_t* path_hash) {
+  *path_hash = PathHash(ex->path());
+  size_t bytes = PathMemory(ex->path());
+  if (frontier_memory_used_ + bytes <= max_frontier_memory_) {
+    frontier_memory_used_ += bytes;
+    return bytes;
+  }
+
+  // Keep only the inputs (and the types of the variables).
+  SymbolicPath empty;
+  ex->mutable_path()->Swap(empty);
+  return 0;
+}
+
+
+bool Search::ResumeExecution(size_t kept, size_t path_hash,
+                             SymbolicExecution* ex) {
+  if (kept > 0) {
+    frontier_memory_used_ -= kept;
+    return true;
+  }
+
+  num_reexecutions_++;
+  vector<value_t> input(ex->inputs());
+  if (!RunProgram(input, ex))
+    return false;
+  if (PathHash(ex->path()) != path_hash) {
+    // (E.g. the program is not deterministic.)
+    fprintf(stderr, "Re-execution took a different path.\n");
+    num_reexecutions_diverged_++;
+    SymbolicExecution empty;
+    ex->Swap(empty);
+    return false;
+  }
+  return true;
 }
 
 
@@ -222,13 +913,48 @@ bool Search::UpdateCoverage(const SymbolicExecution& ex) {
 
 bool Search::UpdateCoverage(const SymbolicExecution& ex,
 			    set<branch_id_t>* new_branches) {
+  // (The distinct branches of the path, rather than the whole path,
+  // which can be far longer.)
+  const vector<branch_id_t>& taken = ex.path().distinct_branches();
+  if (!corpus_)
+    return AddCoverage(taken, new_branches);
+
+  // Save the input to the corpus if it covers anything new (overall,
+  // not just since the strategy last reset its coverage).
+  vector<branch_id_t> first_covered;
+  for (BranchIt i = taken.begin(); i != taken.end(); ++i) {
+    if ((*i > 0) && !total_covered_[*i]) {
+      first_covered.push_back(*i);
+    }
+  }
+  bool found_new_branch = AddCoverage(taken, new_branches);
+  if (!first_covered.empty()) {
+    // (The corpus holds the original branch ids.)
+    for (size_t i = 0; i < first_covered.size(); i++) {
+      first_covered[i] = raw_branch_[first_covered[i]];
+    }
+    sort(first_covered.begin(), first_covered.end());
+    first_covered.erase(unique(first_covered.begin(), first_covered.end()),
+                        first_covered.end());
+    vector<branch_id_t> raw_taken(taken);
+    for (size_t i = 0; i < raw_taken.size(); i++) {
+      if (raw_taken[i] > 0)
+        raw_taken[i] = raw_branch_[raw_taken[i]];
+    }
+    corpus_->Add(ex.inputs(), first_covered, raw_taken);
+  }
+  return found_new_branch;
+}
+
+bool Search::AddCoverage(const vector<branch_id_t>& branches,
+                         set<branch_id_t>* new_branches) {
 
   const unsigned int prev_covered_ = num_covered_;
-  const vector<branch_id_t>& branches = ex.path().branches();
   for (BranchIt i = branches.begin(); i != branches.end(); ++i) {
     if ((*i > 0) && !covered_[*i]) {
-      covered_[*i] = true;
+      covered_.Set(*i);
       num_covered_++;
+      BranchCovered(*i);
       if (new_branches) {
 	new_branches->insert(*i);
       }
@@ -239,8 +965,15 @@ bool Search::UpdateCoverage(const SymbolicExecution& ex,
       }
     }
     if ((*i > 0) && !total_covered_[*i]) {
-      total_covered_[*i] = true;
+      total_covered_.Set(*i);
       total_num_covered_++;
+      if (!targets_.empty() && is_target_[*i]) {
+        num_targets_hit_++;
+        last_target_iter_ = num_iters_;
+        last_target_time_ = difftime(time(NULL), start_time_);
+        fprintf(stderr, "Hit target %d at iteration %d (%.0fs).\n",
+                raw_branch_[*i], num_iters_, last_target_time_);
+      }
     }
   }
 
@@ -256,6 +989,18 @@ bool Search::UpdateCoverage(const SymbolicExecution& ex,
 }
 
 
+bool Search::CountIterations(int n) {
+  num_iters_ += n;
+  return !BudgetExhausted();
+}
+
+
+void Search::CountWorkTime(double program_time, const Solver::Stats& stats) {
+  program_time_ += program_time;
+  other_solver_stats_.Add(stats);
+}
+
+
 void Search::RandomInput(const map<var_t,type_t>& vars, vector<value_t>* input) {
   input->resize(vars.size());
 
@@ -290,49 +1035,287 @@ void Search::RandomInput(const map<var_t,type_t>& vars, vector<value_t>* input)
 }
 
 
-bool Search::SolveAtBranch(const SymbolicExecution& ex,
-                           size_t branch_idx,
-                           vector<value_t>* input) {
+solve_result_t Search::SolveAtBranch(const SymbolicExecution& ex,
+                                     size_t branch_idx,
+                                     vector<value_t>* input) {
+  if (NegationTried(ex, branch_idx)) {
+    num_skipped_solves_++;
+    return results::UNSAT;
+  }
 
-  const vector<SymbolicPred*>& constraints = ex.path().constraints();
+  if (SolverOverBudget()) {
+    ScheduleRetry(ex, branch_idx, solver_timeout_, 0);
+    return results::UNKNOWN;
+  }
 
-  // Optimization: If any of the previous constraints are idential to the
-  // branch_idx-th constraint, immediately return false.
-  for (int i = static_cast<int>(branch_idx) - 1; i >= 0; i--) {
-    if (constraints[branch_idx]->Equal(*constraints[i]))
-      return false;
+  double start = WallTime();
+  solve_result_t result =
+    solver_pool_->Solve(ex, branch_idx, solver_timeout_, input);
+  RecordSolves(ex, vector<size_t>(1, branch_idx),
+               vector<solve_result_t>(1, result),
+               vector<double>(1, WallTime() - start));
+  if (result == results::UNKNOWN) {
+    ScheduleRetry(ex, branch_idx, 2 * solver_timeout_, 1);
+  } else if (result == results::UNSAT) {
+    tree_.Mark(ex.path(), branch_idx, ExecutionTree::UNSAT);
   }
+  return result;
+}
 
-  vector<const SymbolicPred*> cs(constraints.begin(),
-				 constraints.begin()+branch_idx+1);
-  map<var_t,value_t> soln;
-  constraints[branch_idx]->Negate();
-  // fprintf(stderr, "Yices . . . ");
-  bool success = YicesSolver::IncrementalSolve(ex.inputs(), ex.vars(), cs, &soln);
-  // fprintf(stderr, "%d\n", success);
-  constraints[branch_idx]->Negate();
 
+void Search::SolveAtBranches(const SymbolicExecution& ex,
+                             const vector<size_t>& idxs,
+                             vector<solve_result_t>* solved,
+                             vector< vector<value_t> >* inputs) {
+  solved->assign(idxs.size(), results::UNSAT);
+  inputs->assign(idxs.size(), vector<value_t>());
+
+  // Only solve the negations which have not been tried already.
+  vector<size_t> todo;
+  vector<size_t> todo_idxs;
+  for (size_t k = 0; k < idxs.size(); k++) {
+    if (NegationTried(ex, idxs[k])) {
+      num_skipped_solves_++;
+    } else {
+      todo.push_back(k);
+      todo_idxs.push_back(idxs[k]);
+    }
+  }
+  if (todo.empty())
+    return;
+
+  if (SolverOverBudget()) {
+    for (size_t k = 0; k < todo.size(); k++) {
+      (*solved)[todo[k]] = results::UNKNOWN;
+      ScheduleRetry(ex, todo_idxs[k], solver_timeout_, 0);
+    }
+    return;
+  }
+
+  vector<solve_result_t> todo_solved;
+  vector< vector<value_t> > todo_inputs;
+  vector<double> todo_seconds;
+  solver_pool_->SolveBatch(ex, todo_idxs, solver_timeout_,
+                           &todo_solved, &todo_inputs, &todo_seconds);
+  RecordSolves(ex, todo_idxs, todo_solved, todo_seconds);
+  for (size_t k = 0; k < todo.size(); k++) {
+    (*solved)[todo[k]] = todo_solved[k];
+    (*inputs)[todo[k]].swap(todo_inputs[k]);
+    if (todo_solved[k] == results::UNKNOWN) {
+      ScheduleRetry(ex, todo_idxs[k], 2 * solver_timeout_, 1);
+    } else if (todo_solved[k] == results::UNSAT) {
+      tree_.Mark(ex.path(), todo_idxs[k], ExecutionTree::UNSAT);
+    }
+  }
+}
+
+
+void Search::RecordSolves(const SymbolicExecution& ex,
+                          const vector<size_t>& idxs,
+                          const vector<solve_result_t>& results,
+                          const vector<double>& seconds) {
+  if (idxs.empty())
+    return;
+  vector<size_t> slice_sizes, slice_vars;
+  CostModel::ComputeSlices(ex, *max_element(idxs.begin(), idxs.end()) + 1,
+                           &slice_sizes, &slice_vars);
+  for (size_t k = 0; k < idxs.size(); k++) {
+    size_t i = idxs[k];
+    branch_id_t b = NegatedBranch(ex, i);
+    cost_model_.RecordSolve(b, slice_sizes[i], slice_vars[i], results[k],
+                            seconds[k]);
+
+    // (A satisfiable query succeeds only if the run takes the predicted
+    // path -- see CheckPrediction.)
+    outcomes_[b].attempts++;
+    if (results[k] == results::UNSAT) {
+      outcomes_[b].unsat++;
+      RecordOutcome(b, false);
+    } else if (results[k] == results::UNKNOWN) {
+      outcomes_[b].timeouts++;
+      RecordOutcome(b, false);
+    }
+  }
+}
+
+
+void Search::RecordOutcome(branch_id_t b, bool success) {
+  BranchOutcomes& o = outcomes_[b];
   if (success) {
-    // Merge the solution with the previous input to get the next
-    // input.  (Could merge with random inputs, instead.)
-    *input = ex.inputs();
-    // RandomInput(ex.vars(), input);
+    o.successes++;
+    o.failures = 0;
+  } else {
+    o.failures++;
+  }
+}
+
+
+void Search::RankBranches(const SymbolicExecution& ex,
+                          vector<ScoredBranch>* branches) const {
+  if (branches->empty())
+    return;
+  const SymbolicPath& path = ex.path();
+  vector<size_t> slice_sizes, slice_vars;
+  CostModel::ComputeSlices(ex, path.constraints().size(),
+                           &slice_sizes, &slice_vars);
+  const double run_time = cost_model_.RunTime(path.branches().size());
+
+  // (Keyed by the negated rate, for a stable sort best first.)
+  vector< pair<double,ScoredBranch> > rated(branches->size());
+  for (size_t k = 0; k < branches->size(); k++) {
+    size_t i = (*branches)[k].first;
+    branch_id_t b = NegatedBranch(ex, i);
+    double gain = ldexp(cost_model_.SatProbability(b)
+                        / (1.0 + max((*branches)[k].second, 0)),
+                        -static_cast<int>(min(outcomes_[b].failures, 64u)));
+    double cost = (cost_model_.SolveTime(b, slice_sizes[i], slice_vars[i])
+                   + run_time);
+    rated[k] = make_pair(-gain / cost, (*branches)[k]);
+  }
+  stable_sort(rated.begin(), rated.end(), RateComp());
+  for (size_t k = 0; k < rated.size(); k++) {
+    (*branches)[k] = rated[k].second;
+  }
+}
+
+
+bool Search::NegationTried(const SymbolicExecution& ex,
+                           size_t branch_idx) const {
+  // (An explored negation may still lead somewhere new.)
+  ExecutionTree::State state = tree_.Lookup(ex.path(), branch_idx);
+  return ((state != ExecutionTree::UNKNOWN)
+          && (state != ExecutionTree::EXPLORED));
+}
+
 
-    typedef map<var_t,value_t>::const_iterator SolnIt;
-    for (SolnIt i = soln.begin(); i != soln.end(); ++i) {
-      (*input)[i->first] = i->second;
+void Search::MarkInFlight(const SymbolicExecution& ex, size_t branch_idx) {
+  tree_.Mark(ex.path(), branch_idx, ExecutionTree::IN_FLIGHT);
+}
+
+
+bool Search::SolverOverBudget() const {
+  if (max_solver_share_ >= 1)
+    return false;
+
+  time_t elapsed = time(NULL) - start_time_;
+  if (elapsed < kMinSolverShareTime)
+    return false;
+
+  double procs = max(1, solver_pool_->num_workers());
+  return (solver_pool_->stats().solve_time
+          > max_solver_share_ * elapsed * procs);
+}
+
+
+void Search::ScheduleRetry(const SymbolicExecution& ex, size_t branch_idx,
+                           double timeout, int attempts) {
+  // (A query dropped for lack of space may be tried again later.)
+  if (timed_out_.size() >= kMaxTimedOutQueries)
+    return;
+  tree_.Mark(ex.path(), branch_idx, ExecutionTree::TIMED_OUT);
+  if (attempts >= kMaxSolveAttempts)
+    return;
+
+  // Copy the path up to (and including) the constraint to negate.
+  SymbolicExecution* copy = new SymbolicExecution();
+  *copy->mutable_vars() = ex.vars();
+  *copy->mutable_inputs() = ex.inputs();
+  const SymbolicPath& path = ex.path();
+  size_t c = 0;
+  for (size_t i = 0; i <= path.constraints_idx()[branch_idx]; i++) {
+    if ((c < path.constraints_idx().size()) && (path.constraints_idx()[c] == i)) {
+      const SymbolicPred& pred = *path.constraints()[c++];
+      copy->mutable_path()->Push(path.branches()[i],
+                                 new SymbolicPred(pred.op(),
+                                                  new SymbolicExpr(pred.expr())));
+    } else {
+      copy->mutable_path()->Push(path.branches()[i]);
     }
-    return true;
   }
 
-  return false;
+  TimedOutQuery q;
+  q.ex = copy;
+  q.timeout = timeout;
+  q.attempts = attempts;
+  timed_out_.push_back(q);
+}
+
+
+bool Search::RetryTimedOutBranch(SymbolicExecution* ex, size_t* branch_idx) {
+  if (timed_out_.empty() || SolverOverBudget() || BudgetExhausted())
+    return false;
+
+  TimedOutQuery q = timed_out_.front();
+  timed_out_.pop_front();
+
+  size_t idx = q.ex->path().constraints().size() - 1;
+  vector<value_t> input;
+  double start = WallTime();
+  solve_result_t result = solver_pool_->Solve(*q.ex, idx, q.timeout, &input);
+  RecordSolves(*q.ex, vector<size_t>(1, idx),
+               vector<solve_result_t>(1, result),
+               vector<double>(1, WallTime() - start));
+  bool success = false;
+  if (result == results::UNSAT) {
+    tree_.Mark(q.ex->path(), idx, ExecutionTree::UNSAT);
+  }
+  if (result == results::SAT) {
+    if (!RunProgram(input, ex)) {
+      delete q.ex;
+      return false;
+    }
+    UpdateCoverage(*ex);
+    success = CheckPrediction(*q.ex, *ex, q.ex->path().constraints_idx()[idx]);
+    *branch_idx = idx;
+  } else if (result == results::UNKNOWN) {
+    ScheduleRetry(*q.ex, idx, 2 * q.timeout, q.attempts + 1);
+  }
+  delete q.ex;
+
+  return success;
+}
+
+
+void Search::RetryTimedOutBranches() {
+  SymbolicExecution ex;
+  size_t idx;
+  for (size_t n = timed_out_.size(); n > 0; n--) {
+    RetryTimedOutBranch(&ex, &idx);
+  }
+}
+
+
+size_t Search::solver_batch_size() const {
+  return max(1, solver_pool_->num_workers());
 }
 
 
 bool Search::CheckPrediction(const SymbolicExecution& old_ex,
 			     const SymbolicExecution& new_ex,
 			     size_t branch_idx) {
+  if (PathMatches(old_ex, new_ex, branch_idx)) {
+    RecordOutcome(paired_branch_[old_ex.path().branches()[branch_idx]], true);
+    return true;
+  }
+  if (branch_idx < old_ex.path().branches().size()) {
+    branch_id_t b = paired_branch_[old_ex.path().branches()[branch_idx]];
+    outcomes_[b].divergent++;
+    RecordOutcome(b, false);
+  }
+
+  // Record the negation as divergent (if it is one).
+  const vector<size_t>& idx = old_ex.path().constraints_idx();
+  vector<size_t>::const_iterator c =
+    lower_bound(idx.begin(), idx.end(), branch_idx);
+  if ((c != idx.end()) && (*c == branch_idx))
+    tree_.Mark(old_ex.path(), c - idx.begin(), ExecutionTree::DIVERGENT);
+  return false;
+}
+
 
+bool Search::PathMatches(const SymbolicExecution& old_ex,
+                         const SymbolicExecution& new_ex,
+                         size_t branch_idx) const {
   if ((old_ex.path().branches().size() <= branch_idx)
       || (new_ex.path().branches().size() <= branch_idx)) {
     return false;
@@ -356,16 +1339,42 @@ BoundedDepthFirstSearch::BoundedDepthFirstSearch
 (const string& program, int max_iterations, int max_depth)
   : Search(program, max_iterations), max_depth_(max_depth) { }
 
-BoundedDepthFirstSearch::~BoundedDepthFirstSearch() { }
+BoundedDepthFirstSearch::~BoundedDepthFirstSearch() {
+  for (size_t i = 0; i < frames_.size(); i++) {
+    delete frames_[i].ex;
+  }
+}
 
 void BoundedDepthFirstSearch::Run() {
-  // Initial execution (on empty/random inputs).
+  // First continue any search left on the DFS stack -- at the end of
+  // the last slice (see Search::RunSlice), or in a checkpoint.  Then
+  // search from each initial execution (on empty/random inputs, or on
+  // each of the seed inputs in turn).
+  if (!frames_.empty()) {
+    ContinueDFS();
+    if (BudgetExhausted())
+      return;
+  }
+
   SymbolicExecution ex;
-  RunProgram(vector<value_t>(), &ex);
-  UpdateCoverage(ex);
+  do {
+    if (!RunProgram(resume_.empty() ? NextStartingInput() : resume_[0].input, &ex))
+      return;
+    UpdateCoverage(ex);
 
-  DFS(0, max_depth_, ex);
-  // DFS(0, ex);
+    DFS(0, max_depth_, ex);
+    // DFS(0, ex);
+  } while ((num_seed_inputs() > 0) && !BudgetExhausted());
+
+  // Finally, retry the queries on which the solver ran out of time,
+  // continuing the search from those which succeed.
+  size_t idx;
+  for (int i = 0; i < kMaxSolveAttempts; i++) {
+    for (size_t n = num_timed_out(); (n > 0) && !BudgetExhausted(); n--) {
+      if (RetryTimedOutBranch(&ex, &idx))
+        DFS(idx + 1, max_depth_, ex);
+    }
+  }
 }
 
   /*
@@ -388,45 +1397,176 @@ void BoundedDepthFirstSearch::DFS(int depth, SymbolicExecution& prev_ex) {
 
     // Check for prediction failure.
     size_t branch_idx = path.constraints_idx()[i];
-    if (!CheckPrediction(prev_ex, cur_ex, branch_idx)) {
+    if (!CheckPrediction(prev_ex, cur_ex, branch_idx)) {
+      fprintf(stderr, "Prediction failed!\n");
+      continue;
+    }
+
+    // Recurse.
+    DFS(i+1, cur_ex);
+  }
+}
+  */
+
+
+void BoundedDepthFirstSearch::DFS(size_t pos, int depth,
+                                  SymbolicExecution& ex) {
+  assert(frames_.empty());
+  SymbolicExecution* root = new SymbolicExecution();
+  root->Swap(ex);
+  PushFrame(root, pos, depth);
+
+  if (!resume_.empty()) {
+    // Resuming: rebuild the saved stack, re-running the child being
+    // explored at each level.
+    frames_.back().pos = resume_[0].pos;
+    frames_.back().depth = resume_[0].depth;
+    for (size_t level = 1; level < resume_.size(); level++) {
+      const Frame& top = frames_.back();
+      if ((top.pos >= top.ex->path().constraints().size()) || (top.depth <= 0))
+        break;
+      SymbolicExecution* child = new SymbolicExecution();
+      if (!RunProgram(resume_[level].input, child)) {
+        delete child;
+        return;
+      }
+      UpdateCoverage(*child);
+      PushFrame(child, resume_[level].pos, resume_[level].depth);
+    }
+    resume_.clear();
+  }
+
+  ContinueDFS();
+}
+
+
+void BoundedDepthFirstSearch::ContinueDFS() {
+  while (!frames_.empty()) {
+    Frame& f = frames_.back();
+    if (f.suspended) {
+      // Back from exploring a child.
+      if (BudgetExhausted())
+        return;
+      f.suspended = false;
+      if (!ResumeExecution(f.kept, f.path_hash, f.ex)) {
+        // (Abandon the rest of this execution, unless out of budget --
+        // in which case it is still to be resumed.)
+        if (BudgetExhausted()) {
+          f.suspended = true;
+          return;
+        }
+        PopFrame();
+        continue;
+      }
+    }
+
+    const SymbolicPath& path = f.ex->path();
+    const size_t i = f.pos;
+    if ((i >= path.constraints().size()) || (f.depth <= 0)) {
+      PopFrame();
+      continue;
+    }
+    if (BudgetExhausted()) {
+      // Out of budget -- leave the stack as it is (for the final
+      // checkpoint).
+      return;
+    }
+    MaybeCheckpoint();
+
+    // Solve constraints[0..i].  (We solve the upcoming constraints in
+    // batches, so that they can be handled by the solver workers in
+    // parallel.)
+    if (f.idxs.empty() || (i > f.idxs.back())) {
+      f.idxs.clear();
+      for (size_t j = i; j < path.constraints().size(); j++) {
+        if (f.idxs.size() == solver_batch_size())
+          break;
+        f.idxs.push_back(j);
+      }
+      SolveAtBranches(*f.ex, f.idxs, &f.solved, &f.inputs);
+    }
+    if (f.solved[i - f.idxs.front()] != results::SAT) {
+      f.pos++;
+      continue;
+    }
+
+    // Run on those constraints.
+    SymbolicExecution* cur_ex = new SymbolicExecution();
+    if (!RunProgram(f.inputs[i - f.idxs.front()], cur_ex)) {
+      delete cur_ex;
+      return;
+    }
+    UpdateCoverage(*cur_ex);
+
+    // Check for prediction failure.
+    size_t branch_idx = path.constraints_idx()[i];
+    if (!CheckPrediction(*f.ex, *cur_ex, branch_idx)) {
       fprintf(stderr, "Prediction failed!\n");
+      delete cur_ex;
+      f.pos++;
       continue;
     }
 
-    // Recurse.
-    DFS(i+1, cur_ex);
+    // We successfully solved the branch, search below it.
+    PushFrame(cur_ex, i + 1, f.depth - 1);
   }
 }
-  */
 
 
-void BoundedDepthFirstSearch::DFS(size_t pos, int depth, SymbolicExecution& prev_ex) {
-  SymbolicExecution cur_ex;
-  vector<value_t> input;
+void BoundedDepthFirstSearch::PushFrame(SymbolicExecution* ex,
+                                        size_t pos, int depth) {
+  if (!frames_.empty()) {
+    Frame& parent = frames_.back();
+    parent.kept = SuspendExecution(parent.ex, &parent.path_hash);
+    parent.suspended = true;
+    if (parent.kept > 0)
+      ex->mutable_path()->SharePrefix(parent.ex->path(), parent.pos);
+  }
 
-  const SymbolicPath& path = prev_ex.path();
+  frames_.push_back(Frame());
+  Frame& f = frames_.back();
+  f.ex = ex;
+  f.pos = pos;
+  f.depth = depth;
+  f.suspended = false;
+  f.kept = 0;
+  f.path_hash = 0;
+}
 
-  for (size_t i = pos; (i < path.constraints().size()) && (depth > 0); i++) {
-    // Solve constraints[0..i].
-    if (!SolveAtBranch(prev_ex, i, &input)) {
-      continue;
-    }
 
-    // Run on those constraints.
-    RunProgram(input, &cur_ex);
-    UpdateCoverage(cur_ex);
+void BoundedDepthFirstSearch::PopFrame() {
+  delete frames_.back().ex;
+  frames_.pop_back();
+  if (!frames_.empty()) {
+    frames_.back().pos++;
+    frames_.back().depth--;
+  }
+}
 
-    // Check for prediction failure.
-    size_t branch_idx = path.constraints_idx()[i];
-    if (!CheckPrediction(prev_ex, cur_ex, branch_idx)) {
-      fprintf(stderr, "Prediction failed!\n");
-      continue;
-    }
 
-    // We successfully solved the branch, recurse.
-    depth--;
-    DFS(i+1, depth, cur_ex);
+void BoundedDepthFirstSearch::SaveState(ostream& out) const {
+  Search::SaveState(out);
+  WriteValue(out, frames_.size());
+  for (size_t i = 0; i < frames_.size(); i++) {
+    WriteInput(out, frames_[i].ex->inputs());
+    WriteValue(out, frames_[i].pos);
+    WriteValue(out, frames_[i].depth);
+  }
+}
+
+
+bool BoundedDepthFirstSearch::LoadState(istream& in) {
+  size_t n;
+  if (!Search::LoadState(in) || !ReadValue(in, &n))
+    return false;
+  resume_.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    if (!ReadInput(in, &resume_[i].input)
+        || !ReadValue(in, &resume_[i].pos)
+        || !ReadValue(in, &resume_[i].depth))
+      return false;
   }
+  return true;
 }
 
 
@@ -435,17 +1575,23 @@ void BoundedDepthFirstSearch::DFS(size_t pos, int depth, SymbolicExecution& prev
 ////////////////////////////////////////////////////////////////////////
 
 RandomInputSearch::RandomInputSearch(const string& program, int max_iterations)
-  : Search(program, max_iterations) { }
+  : Search(program, max_iterations), started_(false) { }
 
 RandomInputSearch::~RandomInputSearch() { }
 
 void RandomInputSearch::Run() {
   vector<value_t> input;
-  RunProgram(input, &ex_);
+  // (Unless resuming, run once to find the inputs.)
+  if (!started_) {
+    RunProgram(input, &ex_);
+    started_ = true;
+  }
 
-  while (true) {
+  while (!BudgetExhausted()) {
+    MaybeCheckpoint();
     RandomInput(ex_.vars(), &input);
-    RunProgram(input, &ex_);
+    if (!RunProgram(input, &ex_))
+      break;
     UpdateCoverage(ex_);
   }
 }
@@ -456,35 +1602,46 @@ void RandomInputSearch::Run() {
 ////////////////////////////////////////////////////////////////////////
 
 RandomSearch::RandomSearch(const string& program, int max_iterations)
-  : Search(program, max_iterations) { }
+  : Search(program, max_iterations), in_round_(false), count_(0) { }
 
 RandomSearch::~RandomSearch() { }
 
 void RandomSearch::Run() {
   SymbolicExecution next_ex;
 
-  while (true) {
-    // Execution (on empty/random inputs).
-    fprintf(stderr, "RESET\n");
+  while (!BudgetExhausted()) {
     vector<value_t> next_input;
-    RunProgram(next_input, &ex_);
-    UpdateCoverage(ex_);
+
+    // (Unless resuming in the middle of a round.)
+    if (!in_round_) {
+      MaybeCheckpoint();
+
+      // Execution (on the next seed input, or on empty/random inputs).
+      fprintf(stderr, "RESET\n");
+      RetryTimedOutBranches();
+      next_input = NextStartingInput();
+      if (!RunProgram(next_input, &ex_))
+        break;
+      UpdateCoverage(ex_);
+      count_ = 0;
+    }
+    in_round_ = true;
 
     // Do some iterations.
-    int count = 0;
-    while (count++ < 10000) {
+    while (!BudgetExhausted() && (count_++ < 10000)) {
       // fprintf(stderr, "Uncovered bounded DFS.\n");
       // SolveUncoveredBranches(0, 20, ex_);
 
       size_t idx;
       if (SolveRandomBranch(&next_input, &idx)) {
-	RunProgram(next_input, &next_ex);
+	if (!RunProgram(next_input, &next_ex))
+	  break;
 	bool found_new_branch = UpdateCoverage(next_ex);
 	bool prediction_failed =
 	  !CheckPrediction(ex_, next_ex, ex_.path().constraints_idx()[idx]);
 
 	if (found_new_branch) {
-	  count = 0;
+	  count_ = 0;
 	  ex_.Swap(next_ex);
 	  if (prediction_failed)
 	    fprintf(stderr, "Prediction failed (but got lucky).\n");
@@ -493,8 +1650,16 @@ void RandomSearch::Run() {
 	} else {
 	  fprintf(stderr, "Prediction failed.\n");
 	}
+      } else {
+	// Nothing left to try from here, so start over.
+	break;
       }
     }
+    if (BudgetExhausted()) {
+      // (Stay in this round, for the next slice.)
+      break;
+    }
+    in_round_ = false;
   }
 }
 
@@ -558,7 +1723,7 @@ void RandomSearch::SolveUncoveredBranches(size_t i, int depth,
     if (covered_[paired_branch_[bid]])
       continue;
 
-    if (!SolveAtBranch(prev_ex, j, &input)) {
+    if (SolveAtBranch(prev_ex, j, &input) != results::SAT) {
       if (++cnt == 1000) {
 	cnt = 0;
 	fprintf(stderr, "Failed to solve at %zu/%zu.\n",
@@ -568,7 +1733,8 @@ void RandomSearch::SolveUncoveredBranches(size_t i, int depth,
     }
     cnt = 0;
 
-    RunProgram(input, &cur_ex);
+    if (!RunProgram(input, &cur_ex))
+      return;
     UpdateCoverage(cur_ex);
     if (!CheckPrediction(prev_ex, cur_ex, bid_idx)) {
       fprintf(stderr, "Prediction failed.\n");
@@ -623,16 +1789,20 @@ void RandomSearch::SolveUncoveredBranches(size_t i, int depth,
   for (size_t i = 0; i < idxs.size(); i++)
     idxs[i] = i;
 
-  for (int tries = 0; tries < 1000; tries++) {
+  int tries = 0;
+  while ((tries < 1000) && !idxs.empty()) {
     // Pick a random index.
-    if (idxs.size() == 0)
-      break;
     size_t r = rand() % idxs.size();
     size_t i = idxs[r];
     swap(idxs[r], idxs.back());
     idxs.pop_back();
 
-    if (SolveAtBranch(ex_, i, next_input)) {
+    // (Skipping, without using up a try, the negations already tried.)
+    if (NegationTried(ex_, i))
+      continue;
+
+    tries++;
+    if (SolveAtBranch(ex_, i, next_input) == results::SAT) {
       fprintf(stderr, "Solved %zu/%zu\n", i, idxs.size());
       *idx = i;
       return true;
@@ -653,51 +1823,67 @@ void RandomSearch::SolveUncoveredBranches(size_t i, int depth,
 UniformRandomSearch::UniformRandomSearch(const string& program,
 					 int max_iterations,
 					 size_t max_depth)
-  : Search(program, max_iterations), max_depth_(max_depth) { }
+  : Search(program, max_iterations), started_(false),
+    max_depth_(max_depth) { }
 
 UniformRandomSearch::~UniformRandomSearch() { }
 
 void UniformRandomSearch::Run() {
-  // Initial execution (on empty/random inputs).
-  RunProgram(vector<value_t>(), &prev_ex_);
-  UpdateCoverage(prev_ex_);
+  // Initial execution (on a seed input, or on empty/random inputs) --
+  // unless resuming from the last path of an earlier slice.
+  if (!started_) {
+    RunProgram(NextStartingInput(), &prev_ex_);
+    UpdateCoverage(prev_ex_);
+    started_ = true;
+  }
 
-  while (true) {
+  while (!BudgetExhausted()) {
+    MaybeCheckpoint();
     fprintf(stderr, "RESET\n");
-
-    // Uniform random path.
-    DoUniformRandomPath();
+    RetryTimedOutBranches();
+
+    // Uniform random path -- or, if that found nothing left to try,
+    // a fresh starting input.
+    if (!DoUniformRandomPath()) {
+      if (!RunProgram(NextStartingInput(), &prev_ex_))
+        break;
+      UpdateCoverage(prev_ex_);
+    }
   }
 }
 
-void UniformRandomSearch::DoUniformRandomPath() {
+bool UniformRandomSearch::DoUniformRandomPath() {
   vector<value_t> input;
+  bool ran = false;
 
   size_t i = 0;
   size_t depth = 0;
   fprintf(stderr, "%zu constraints.\n", prev_ex_.path().constraints().size());
-  while ((i < prev_ex_.path().constraints().size()) && (depth < max_depth_)) {
-    if (SolveAtBranch(prev_ex_, i, &input)) {
+  while ((i < prev_ex_.path().constraints().size()) && (depth < max_depth_)
+         && !BudgetExhausted()) {
+    // With probability 0.5, force the i-th constraint.
+    if ((rand() % 2 == 0)
+        && (SolveAtBranch(prev_ex_, i, &input) == results::SAT)) {
       fprintf(stderr, "Solved constraint %zu/%zu.\n",
 	      (i+1), prev_ex_.path().constraints().size());
       depth++;
 
-      // With probability 0.5, force the i-th constraint.
-      if (rand() % 2 == 0) {
-	RunProgram(input, &cur_ex_);
-	UpdateCoverage(cur_ex_);
-	size_t branch_idx = prev_ex_.path().constraints_idx()[i];
-	if (!CheckPrediction(prev_ex_, cur_ex_, branch_idx)) {
-	  fprintf(stderr, "prediction failed\n");
-	  depth--;
-	} else {
-	  cur_ex_.Swap(prev_ex_);
-	}
+      if (!RunProgram(input, &cur_ex_))
+        return true;
+      ran = true;
+      UpdateCoverage(cur_ex_);
+      size_t branch_idx = prev_ex_.path().constraints_idx()[i];
+      if (!CheckPrediction(prev_ex_, cur_ex_, branch_idx)) {
+        fprintf(stderr, "prediction failed\n");
+        depth--;
+      } else {
+        cur_ex_.Swap(prev_ex_);
       }
     }
 
     i++;
   }
+  return ran;
 }
 
 
@@ -706,22 +1892,39 @@ void UniformRandomSearch::DoUniformRandomPath() {
 ////////////////////////////////////////////////////////////////////////
 
 HybridSearch::HybridSearch(const string& program, int max_iterations, int step_size)
-  : Search(program, max_iterations), step_size_(step_size) { }
+  : Search(program, max_iterations), step_size_(step_size),
+    in_round_(false), pos_(0) { }
 
 HybridSearch::~HybridSearch() { }
 
 void HybridSearch::Run() {
-  SymbolicExecution ex;
-
-  while (true) {
-    // Execution on empty/random inputs.
-    RunProgram(vector<value_t>(), &ex);
-    UpdateCoverage(ex);
-
-    // Local searches at increasingly deeper execution points.
-    for (size_t pos = 0; pos < ex.path().constraints().size(); pos += step_size_) {
-      RandomLocalSearch(&ex, pos, pos+step_size_);
+  while (!BudgetExhausted()) {
+    // (Unless resuming in the middle of a round.)
+    if (!in_round_) {
+      MaybeCheckpoint();
+      RetryTimedOutBranches();
+
+      // Execution on the next seed input (or on empty/random inputs).
+      if (!RunProgram(NextStartingInput(), &ex_))
+        break;
+      UpdateCoverage(ex_);
+      pos_ = 0;
+    }
+    in_round_ = true;
+
+    // Local searches at increasingly deeper execution points.  (One cut
+    // short by the end of a slice is started over in the next.)
+    while ((pos_ < ex_.path().constraints().size()) && !BudgetExhausted()) {
+      RandomLocalSearch(&ex_, pos_, pos_+step_size_);
+      if (BudgetExhausted())
+        break;
+      pos_ += step_size_;
+    }
+    if (BudgetExhausted()) {
+      // (Stay in this round, for the next slice.)
+      break;
     }
+    in_round_ = false;
   }
 }
 
@@ -757,8 +1960,9 @@ bool HybridSearch::RandomStep(SymbolicExecution *ex, size_t start, size_t end) {
     swap(idxs[r], idxs.back());
     idxs.pop_back();
 
-    if (SolveAtBranch(*ex, i, &input)) {
-      RunProgram(input, &next_ex);
+    if (SolveAtBranch(*ex, i, &input) == results::SAT) {
+      if (!RunProgram(input, &next_ex))
+        return false;
       UpdateCoverage(next_ex);
       if (CheckPrediction(*ex, next_ex, ex->path().constraints_idx()[i])) {
 	ex->Swap(next_ex);
@@ -776,24 +1980,36 @@ bool HybridSearch::RandomStep(SymbolicExecution *ex, size_t start, size_t end) {
 ////////////////////////////////////////////////////////////////////////
 
 CfgBaselineSearch::CfgBaselineSearch(const string& program, int max_iterations)
-  : Search(program, max_iterations) { }
+  : Search(program, max_iterations), in_round_(false) { }
 
 CfgBaselineSearch::~CfgBaselineSearch() { }
 
 
 void CfgBaselineSearch::Run() {
-  SymbolicExecution ex;
-
-  while (true) {
-    // Execution on empty/random inputs.
-    fprintf(stderr, "RESET\n");
-    RunProgram(vector<value_t>(), &ex);
-    UpdateCoverage(ex);
+  while (!BudgetExhausted()) {
+    // (Unless resuming in the middle of a round -- in which case the
+    // search starts over from the round's latest execution.)
+    if (!in_round_) {
+      MaybeCheckpoint();
+
+      // Execution on the next seed input (or on empty/random inputs).
+      fprintf(stderr, "RESET\n");
+      RetryTimedOutBranches();
+      if (!RunProgram(NextStartingInput(), &ex_))
+        break;
+      UpdateCoverage(ex_);
+    }
+    in_round_ = true;
 
-    while (DoSearch(5, 250, 0, ex)) {
+    while (DoSearch(5, 250, 0, ex_)) {
       // As long as we keep finding new branches . . . .
-      ex.Swap(success_ex_);
+      ex_.Swap(success_ex_);
+    }
+    if (BudgetExhausted()) {
+      // (Stay in this round, for the next slice.)
+      break;
     }
+    in_round_ = false;
   }
 }
 
@@ -824,22 +2040,40 @@ bool CfgBaselineSearch::DoSearch(int depth, int iters, int pos,
       seen[bid] += 1;
     }
   }
-  stable_sort(scoredBranches.begin(), scoredBranches.end(), ScoredBranchComp());
+  RankBranches(prev_ex, &scoredBranches);
 
-  // Solve.
+  // Solve, in batches (in order of increasing score) so that solver
+  // workers can handle them in parallel.
   SymbolicExecution cur_ex;
-  vector<value_t> input;
+  vector<size_t> idxs;
+  vector<solve_result_t> solved;
+  vector< vector<value_t> > inputs;
+  size_t batch_start = 0;
   for (size_t i = 0; i < scoredBranches.size(); i++) {
     if (iters <= 0) {
       return false;
     }
 
-    if (!SolveAtBranch(prev_ex, scoredBranches[i].first, &input)) {
+    if (i == batch_start + idxs.size()) {
+      batch_start = i;
+      idxs.clear();
+      for (size_t j = i; j < scoredBranches.size(); j++) {
+        if (idxs.size() == solver_batch_size())
+          break;
+        idxs.push_back(scoredBranches[j].first);
+      }
+      SolveAtBranches(prev_ex, idxs, &solved, &inputs);
+    }
+    if (solved[i - batch_start] != results::SAT) {
       continue;
     }
 
-    RunProgram(input, &cur_ex);
+    if (!RunProgram(inputs[i - batch_start], &cur_ex))
+      return false;
     iters--;
+    // (Only to record the branch's outcome.)
+    CheckPrediction(prev_ex, cur_ex,
+                    prev_ex.path().constraints_idx()[scoredBranches[i].first]);
 
     if (UpdateCoverage(cur_ex, NULL)) {
       success_ex_.Swap(cur_ex);
@@ -852,36 +2086,162 @@ bool CfgBaselineSearch::DoSearch(int depth, int iters, int pos,
 
 
 ////////////////////////////////////////////////////////////////////////
-//// CfgHeuristicSearch ////////////////////////////////////////////////
+//// GenerationalSearch ////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
 
-CfgHeuristicSearch::CfgHeuristicSearch
-(const string& program, int max_iterations)
-  : Search(program, max_iterations),
-    cfg_(max_branch_), cfg_rev_(max_branch_), dist_(max_branch_) {
-
-  // Read in the CFG.
-  ifstream in("cfg_branches", ios::in | ios::binary);
-  assert(in);
-  size_t num_branches;
-  in.read((char*)&num_branches, sizeof(num_branches));
-  assert(num_branches == branches_.size());
-  for (size_t i = 0; i < num_branches; i++) {
-    branch_id_t src;
-    size_t len;
-    in.read((char*)&src, sizeof(src));
-    in.read((char*)&len, sizeof(len));
-    cfg_[src].resize(len);
-    in.read((char*)&cfg_[src].front(), len * sizeof(branch_id_t));
+GenerationalSearch::GenerationalSearch(const string& program, int max_iterations)
+  : Search(program, max_iterations), num_children_(0) { }
+
+GenerationalSearch::~GenerationalSearch() {
+  for (ChildQueue::iterator i = queue_.begin(); i != queue_.end(); ++i) {
+    delete i->second.ex;
   }
-  in.close();
+}
 
-  // Construct the reversed CFG.
-  for (BranchIt i = branches_.begin(); i != branches_.end(); ++i) {
-    for (BranchIt j = cfg_[*i].begin(); j != cfg_[*i].end(); ++j) {
-      cfg_rev_[*j].push_back(*i);
+
+void GenerationalSearch::Run() {
+  while (!BudgetExhausted()) {
+    MaybeCheckpoint();
+
+    if (queue_.empty()) {
+      // Execution on the next seed input (or on empty/random inputs).
+      fprintf(stderr, "RESET\n");
+      RetryTimedOutBranches();
+      SymbolicExecution* ex = new SymbolicExecution();
+      if (!RunProgram(NextStartingInput(), ex)) {
+        delete ex;
+        break;
+      }
+      UpdateCoverage(*ex);
+      Enqueue(ex, 0, 0);
+    }
+
+    // Expand the most promising execution.  (If the budget runs out
+    // part way, it goes back on the queue to finish expanding.)
+    ChildQueue::key_type key = queue_.begin()->first;
+    Child c = queue_.begin()->second;
+    queue_.erase(queue_.begin());
+    if (Expand(*c.ex, &c.bound)) {
+      delete c.ex;
+    } else {
+      queue_.insert(make_pair(key, c));
+    }
+  }
+}
+
+
+bool GenerationalSearch::Expand(const SymbolicExecution& ex, size_t* bound) {
+  // Solve for all of the children at once -- in one incremental solver
+  // context, or in parallel across the solver workers.
+  vector<size_t> idxs;
+  for (size_t i = *bound; i < ex.path().constraints().size(); i++) {
+    idxs.push_back(i);
+  }
+  vector<solve_result_t> solved;
+  vector< vector<value_t> > inputs;
+  SolveAtBranches(ex, idxs, &solved, &inputs);
+
+  for (size_t k = 0; k < idxs.size(); k++) {
+    if (solved[k] != results::SAT)
+      continue;
+
+    SymbolicExecution* child = new SymbolicExecution();
+    if (!RunProgram(inputs[k], child)) {
+      delete child;
+      *bound = idxs[k];
+      return false;
+    }
+    // (Only to record the branch's outcome.)
+    CheckPrediction(ex, *child, ex.path().constraints_idx()[idxs[k]]);
+    set<branch_id_t> new_branches;
+    UpdateCoverage(*child, &new_branches);
+    Enqueue(child, idxs[k] + 1, new_branches.size());
+  }
+  return true;
+}
+
+
+void GenerationalSearch::Enqueue(SymbolicExecution* ex, size_t bound, int score) {
+  ChildQueue::key_type key = make_pair(-score, num_children_++);
+
+  if (queue_.size() >= kMaxQueueSize) {
+    // Make room by dropping the least promising child (which may be
+    // this one).
+    ChildQueue::iterator worst = queue_.end();
+    --worst;
+    if (!(key < worst->first)) {
+      delete ex;
+      return;
+    }
+    delete worst->second.ex;
+    queue_.erase(worst);
+  }
+
+  Child c;
+  c.ex = ex;
+  c.bound = bound;
+  queue_[key] = c;
+}
+
+
+void GenerationalSearch::SaveState(ostream& out) const {
+  Search::SaveState(out);
+  WriteValue(out, num_children_);
+  WriteValue(out, queue_.size());
+  for (ChildQueue::const_iterator i = queue_.begin(); i != queue_.end(); ++i) {
+    WriteValue(out, i->first);
+    WriteValue(out, i->second.bound);
+    WriteExecution(out, *i->second.ex);
+  }
+}
+
+
+bool GenerationalSearch::LoadState(istream& in) {
+  size_t n;
+  if (!Search::LoadState(in)
+      || !ReadValue(in, &num_children_) || !ReadValue(in, &n))
+    return false;
+  for (size_t i = 0; i < n; i++) {
+    ChildQueue::key_type key;
+    Child c;
+    if (!ReadValue(in, &key) || !ReadValue(in, &c.bound))
+      return false;
+    c.ex = new SymbolicExecution();
+    if (!c.ex->Parse(in)) {
+      delete c.ex;
+      return false;
     }
+    queue_[key] = c;
   }
+  return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//// CfgHeuristicSearch ////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////
+
+const size_t CfgHeuristicSearch::kInfiniteDistance;
+
+CfgHeuristicSearch::CfgHeuristicSearch
+(const string& program, int max_iterations)
+  : Search(program, max_iterations),
+    dist_(max_branch_),
+    affected_(max_branch_, false), dist_version_(1), in_round_(false) {
+
+  // Zero the stats.
+  num_inner_solves_ = num_inner_successes_pred_fail_ = 0;
+  num_inner_lucky_successes_ = num_inner_zero_successes_ = 0;
+  num_inner_nonzero_successes_ = num_inner_recursive_successes_ = 0;
+  num_inner_unsats_ = num_inner_unknowns_ = num_inner_pred_fails_ = 0;
+  num_top_solves_ = num_top_solve_successes_ = 0;
+  num_solves_ = num_solve_successes_ = num_solve_sat_attempts_ = 0;
+  num_solve_unsats_ = num_solve_unknowns_ = num_solve_recurses_ = 0;
+  num_solve_pred_fails_ = num_solve_all_concrete_ = num_solve_no_paths_ = 0;
+
+  // Read in the CFG (from the cache, if it is up to date).
+  cfg_.LoadOrDie("cfg_branches", "cfg_csr", dense_branch_, max_branch_);
+  ComputeFunctionSummaries();
 }
 
 
@@ -889,58 +2249,138 @@ CfgHeuristicSearch::~CfgHeuristicSearch() { }
 
 
 void CfgHeuristicSearch::Run() {
-  set<branch_id_t> newly_covered_;
-  SymbolicExecution ex;
-
-  while (true) {
-    covered_.assign(max_branch_, false);
-    num_covered_ = 0;
+  while (!BudgetExhausted()) {
+    // (Unless resuming in the middle of a round.)
+    if (!in_round_) {
+      MaybeCheckpoint();
+
+      covered_.Clear();
+      num_covered_ = 0;
+
+      if (targets_.empty()) {
+        // With nothing covered, every branch is at distance 0.
+        for (BranchIt i = branches_.begin(); i != branches_.end(); ++i) {
+          dist_[*i] = 0;
+        }
+        newly_covered_.clear();
+        dist_version_++;
+      } else {
+        // (The distances to the targets do not depend on the round.)
+        UpdateBranchDistances();
+      }
 
-    // Execution on empty/random inputs.
-    fprintf(stderr, "RESET\n");
-    RunProgram(vector<value_t>(), &ex);
-    if (UpdateCoverage(ex)) {
-      UpdateBranchDistances();
-      PrintStats();
+      // Execution on the next seed input (or on empty/random inputs).
+      fprintf(stderr, "RESET\n");
+      RetryTimedOutBranches();
+      if (!RunProgram(NextStartingInput(), &ex_))
+        break;
+      if (UpdateSourceCoverage(ex_)) {
+        UpdateBranchDistances();
+        PrintStats();
+      }
     }
+    in_round_ = true;
 
-    // while (DoSearch(3, 200, 0, kInfiniteDistance+10, ex)) {
-    while (DoSearch(5, 30, 0, kInfiniteDistance, ex)) {
-    // while (DoSearch(3, 10000, 0, kInfiniteDistance, ex)) {
+    // while (DoSearch(3, 200, 0, kInfiniteDistance+10, ex_)) {
+    while (DoSearch(5, 30, 0, kInfiniteDistance, ex_)) {
+    // while (DoSearch(3, 10000, 0, kInfiniteDistance, ex_)) {
       PrintStats();
       // As long as we keep finding new branches . . . .
       UpdateBranchDistances();
-      ex.Swap(success_ex_);
+      ex_.Swap(success_ex_);
+      MaybeCheckpoint();
     }
     PrintStats();
+    if (BudgetExhausted()) {
+      // (Stay in this round, for the final checkpoint.)
+      break;
+    }
+    in_round_ = false;
   }
 }
 
 
+void CfgHeuristicSearch::SaveState(ostream& out) const {
+  Search::SaveState(out);
+  WriteValue(out, in_round_);
+  if (in_round_)
+    WriteExecution(out, ex_);
+}
+
+
+bool CfgHeuristicSearch::SetTargets(const vector<branch_id_t>& ids) {
+  if (!Search::SetTargets(ids))
+    return false;
+  ComputeBranchDistances();
+  return true;
+}
+
+
+bool CfgHeuristicSearch::LoadState(istream& in) {
+  if (!Search::LoadState(in) || !ReadValue(in, &in_round_))
+    return false;
+  if (in_round_ && !ex_.Parse(in))
+    return false;
+
+  // The distances follow from the coverage.
+  ComputeBranchDistances();
+  return true;
+}
+
+
 void CfgHeuristicSearch::PrintStats() {
   fprintf(stderr, "Cfg solves: %u/%u (%u lucky [%u continued], %u on 0's, %u on others,"
-	  "%u unsats, %u prediction failures)\n",
+	  "%u unsats, %u unknowns, %u prediction failures)\n",
 	  (num_inner_lucky_successes_ + num_inner_zero_successes_ + num_inner_nonzero_successes_ + num_top_solve_successes_),
 	  num_inner_solves_, num_inner_lucky_successes_, (num_inner_lucky_successes_ - num_inner_successes_pred_fail_),
 	  num_inner_zero_successes_, num_inner_nonzero_successes_,
-	  num_inner_unsats_, num_inner_pred_fails_);
+	  num_inner_unsats_, num_inner_unknowns_, num_inner_pred_fails_);
   fprintf(stderr, "    (recursive successes: %u)\n", num_inner_recursive_successes_);
   fprintf(stderr, "Top-level SolveAlongCfg: %u/%u\n",
 	  num_top_solve_successes_, num_top_solves_);
   fprintf(stderr, "All SolveAlongCfg: %u/%u  (%u all concrete, %u no paths)\n",
 	  num_solve_successes_, num_solves_,
 	  num_solve_all_concrete_, num_solve_no_paths_);
-  fprintf(stderr, "    (sat failures: %u/%u)  (prediction failures: %u) (recursions: %u)\n",
-	  num_solve_unsats_, num_solve_sat_attempts_,
+  fprintf(stderr, "    (sat failures: %u/%u, %u unknown)  (prediction failures: %u) (recursions: %u)\n",
+	  num_solve_unsats_, num_solve_sat_attempts_, num_solve_unknowns_,
 	  num_solve_pred_fails_, num_solve_recurses_);
 }
 
 
-void CfgHeuristicSearch::UpdateBranchDistances() {
-  // We run a BFS backward, starting simultaneously at all uncovered vertices.
+void CfgHeuristicSearch::BranchCovered(branch_id_t b) {
+  newly_covered_.push_back(b);
+}
+
+
+bool CfgHeuristicSearch::UpdateSourceCoverage(const SymbolicExecution& ex,
+                                              set<branch_id_t>* new_branches) {
+  set<branch_id_t> covered;
+  UpdateCoverage(ex, &covered);
+
+  // (Until the distances are updated, exactly the sources are at
+  // distance 0.)
+  bool found = false;
+  for (set<branch_id_t>::const_iterator i = covered.begin();
+       i != covered.end(); ++i) {
+    if (dist_[*i] == 0) {
+      found = true;
+      if (new_branches)
+        new_branches->insert(*i);
+    }
+  }
+  return found;
+}
+
+
+void CfgHeuristicSearch::ComputeBranchDistances() {
+  newly_covered_.clear();
+  dist_version_++;
+
+  // We run a BFS backward, starting simultaneously at all sources (every
+  // uncovered vertex, or every uncovered target).
   queue<branch_id_t> Q;
   for (BranchIt i = branches_.begin(); i != branches_.end(); ++i) {
-    if (!covered_[*i]) {
+    if (IsSource(*i)) {
       dist_[*i] = 0;
       Q.push(*i);
     } else {
@@ -953,7 +2393,7 @@ void CfgHeuristicSearch::UpdateBranchDistances() {
     size_t dist_i = dist_[i];
     Q.pop();
 
-    for (BranchIt j = cfg_rev_[i].begin(); j != cfg_rev_[i].end(); ++j) {
+    for (NbhrIt j = cfg_.pred_begin(i); j != cfg_.pred_end(i); ++j) {
       if (dist_i + 1 < dist_[*j]) {
 	dist_[*j] = dist_i + 1;
 	Q.push(*j);
@@ -963,6 +2403,231 @@ void CfgHeuristicSearch::UpdateBranchDistances() {
 }
 
 
+void CfgHeuristicSearch::UpdateBranchDistances() {
+  // Covering a branch only removes a source of the backward BFS, so
+  // distances can only grow.  First, we find the affected branches,
+  // whose distances grow: the newly covered branches, and any branch
+  // left with no unaffected successor one step closer to an uncovered
+  // branch.  (The affected branches are found in order of their old
+  // distances, and a branch is rechecked whenever another of its
+  // successors turns out to be affected.)
+  dist_version_++;
+  vector<branch_id_t> affected;
+  for (BranchIt i = newly_covered_.begin(); i != newly_covered_.end(); ++i) {
+    if ((dist_[*i] == 0) && !affected_[*i]) {
+      affected_[*i] = true;
+      affected.push_back(*i);
+    }
+  }
+  newly_covered_.clear();
+
+  for (size_t k = 0; k < affected.size(); k++) {
+    const size_t next_dist = dist_[affected[k]] + 1;
+    const branch_id_t b = affected[k];
+    for (NbhrIt i = cfg_.pred_begin(b); i != cfg_.pred_end(b); ++i) {
+      if (affected_[*i] || (dist_[*i] != next_dist))
+        continue;
+      bool supported = false;
+      for (NbhrIt j = cfg_.succ_begin(*i); j != cfg_.succ_end(*i); ++j) {
+        if (!affected_[*j] && (dist_[*j] + 1 == next_dist)) {
+          supported = true;
+          break;
+        }
+      }
+      if (!supported) {
+        affected_[*i] = true;
+        affected.push_back(*i);
+      }
+    }
+  }
+
+  // Then, we recompute the distances of the affected branches, starting
+  // from the (final) distances of their unaffected successors and
+  // relaxing backward among the affected branches in order of distance.
+  typedef pair<size_t,branch_id_t> DistBranch;
+  priority_queue<DistBranch, vector<DistBranch>, greater<DistBranch> > Q;
+  for (BranchIt i = affected.begin(); i != affected.end(); ++i) {
+    assert(!IsSource(*i));
+    size_t d = kInfiniteDistance;
+    for (NbhrIt j = cfg_.succ_begin(*i); j != cfg_.succ_end(*i); ++j) {
+      if (!affected_[*j] && (dist_[*j] + 1 < d))
+        d = dist_[*j] + 1;
+    }
+    dist_[*i] = d;
+    if (d < kInfiniteDistance)
+      Q.push(make_pair(d, *i));
+  }
+
+  while (!Q.empty()) {
+    const size_t dist_i = Q.top().first;
+    const branch_id_t i = Q.top().second;
+    Q.pop();
+    if (dist_i != dist_[i])
+      continue;  // Stale.
+
+    for (NbhrIt j = cfg_.pred_begin(i); j != cfg_.pred_end(i); ++j) {
+      if (affected_[*j] && (dist_i + 1 < dist_[*j])) {
+        dist_[*j] = dist_i + 1;
+        Q.push(make_pair(dist_[*j], *j));
+      }
+    }
+  }
+
+  for (BranchIt i = affected.begin(); i != affected.end(); ++i) {
+    affected_[*i] = false;
+  }
+}
+
+
+void CfgHeuristicSearch::ComputeFunctionSummaries() {
+  // The CFG has edges into called functions, but none out of them, so a
+  // branch is last in its function if it has no successors within the
+  // function.  We run a BFS backward from these, along the edges within
+  // functions, to find each branch's distance from its function's
+  // return.
+  queue<branch_id_t> Q;
+  exit_dist_.assign(max_branch_, kInfiniteDistance);
+  vector<bool> is_entry(max_branch_, false);
+  vector<bool> has_pred(max_branch_, false);
+  for (BranchIt i = branches_.begin(); i != branches_.end(); ++i) {
+    bool has_succ = false;
+    for (NbhrIt j = cfg_.succ_begin(*i); j != cfg_.succ_end(*i); ++j) {
+      if (branch_function_[*j] == branch_function_[*i]) {
+        has_succ = true;
+        has_pred[*j] = true;
+      } else {
+        // A call.
+        is_entry[*j] = true;
+      }
+    }
+    if (!has_succ) {
+      exit_dist_[*i] = 0;
+      Q.push(*i);
+    }
+  }
+
+  while (!Q.empty()) {
+    branch_id_t i = Q.front();
+    Q.pop();
+    for (NbhrIt j = cfg_.pred_begin(i); j != cfg_.pred_end(i); ++j) {
+      if ((branch_function_[*j] == branch_function_[i])
+          && (exit_dist_[*j] == kInfiniteDistance)) {
+        exit_dist_[*j] = exit_dist_[i] + 1;
+        Q.push(*j);
+      }
+    }
+  }
+
+  // The entry branches of a function are those reached by calls.  (For
+  // functions only called through pointers, or from other files, we
+  // fall back to the branches with no predecessors in the function --
+  // or, failing that, to all of its branches.)
+  entry_branches_.assign(max_function_, vector<branch_id_t>());
+  for (BranchIt i = branches_.begin(); i != branches_.end(); ++i) {
+    if (is_entry[*i])
+      entry_branches_[branch_function_[*i]].push_back(*i);
+  }
+  for (int pass = 0; pass < 2; pass++) {
+    vector<bool> done(max_function_, false);
+    for (size_t f = 0; f < entry_branches_.size(); f++) {
+      done[f] = !entry_branches_[f].empty();
+    }
+    for (BranchIt i = branches_.begin(); i != branches_.end(); ++i) {
+      if (!done[branch_function_[*i]] && ((pass == 1) || !has_pred[*i]))
+        entry_branches_[branch_function_[*i]].push_back(*i);
+    }
+  }
+
+  entry_exit_dist_.assign(max_function_, 0);
+  for (size_t f = 0; f < entry_branches_.size(); f++) {
+    const vector<branch_id_t>& entries = entry_branches_[f];
+    if (entries.empty())
+      continue;
+    entry_exit_dist_[f] = kInfiniteDistance;
+    for (BranchIt i = entries.begin(); i != entries.end(); ++i) {
+      entry_exit_dist_[f] = min(entry_exit_dist_[f], exit_dist_[*i] + 1);
+    }
+  }
+
+  entry_dist_.assign(max_function_, kInfiniteDistance);
+  entry_dist_version_.assign(max_function_, 0);
+}
+
+
+size_t CfgHeuristicSearch::EntryDistance(function_id_t f) {
+  if (entry_dist_version_[f] != dist_version_) {
+    size_t d = kInfiniteDistance;
+    const vector<branch_id_t>& entries = entry_branches_[f];
+    for (BranchIt i = entries.begin(); i != entries.end(); ++i) {
+      d = min(d, dist_[*i]);
+    }
+    entry_dist_[f] = d;
+    entry_dist_version_[f] = dist_version_;
+  }
+  return entry_dist_[f];
+}
+
+
+size_t CfgHeuristicSearch::ContinueDistance(branch_id_t b) const {
+  // The distance from b to an uncovered branch, without entering any
+  // function called right after b.
+  size_t d = kInfiniteDistance;
+  for (NbhrIt j = cfg_.succ_begin(b); j != cfg_.succ_end(b); ++j) {
+    if (branch_function_[*j] == branch_function_[b])
+      d = min(d, dist_[*j] + 1);
+  }
+  return d;
+}
+
+
+void CfgHeuristicSearch::ReturnDistances(const SymbolicExecution& ex,
+                                         vector<size_t>* ret_dist) {
+  // For each call frame along the path, we track the last branch taken
+  // in the frame, and the distance to an uncovered branch once the
+  // frame's function returns.  A call from a frame whose last branch was
+  // c returns to just after c, so its return distance is the shorter of:
+  // continuing from c within the caller, or the caller's distance from c
+  // to its own return plus the caller's return distance.  (With no
+  // branch yet in the caller, we use the caller's entry instead of c.)
+  const vector<branch_id_t>& path = ex.path().branches();
+  const vector<function_id_t>& calls = ex.path().calls();
+  const vector<size_t>& idxs = ex.path().constraints_idx();
+  ret_dist->resize(idxs.size());
+
+  vector<CallFrame> stack;
+  CallFrame root = { max_function_, -1, kInfiniteDistance };
+  stack.push_back(root);
+  size_t next_call = 0;
+  size_t next_constraint = 0;
+  for (size_t i = 0; i < path.size(); i++) {
+    CallFrame& top = stack.back();
+    if ((next_constraint < idxs.size()) && (idxs[next_constraint] == i)) {
+      (*ret_dist)[next_constraint++] = top.ret_dist;
+    }
+
+    if (path[i] == kCallId) {
+      CallFrame callee = { max_function_, -1, top.ret_dist };
+      if (next_call < calls.size())
+        callee.fid = calls[next_call++];
+      if (top.last >= 0) {
+        callee.ret_dist = min(ContinueDistance(top.last),
+                              exit_dist_[top.last] + top.ret_dist);
+      } else if (top.fid < max_function_) {
+        callee.ret_dist = min(EntryDistance(top.fid) + 1,
+                              entry_exit_dist_[top.fid] + top.ret_dist);
+      }
+      callee.ret_dist = min(callee.ret_dist, kInfiniteDistance);
+      stack.push_back(callee);
+    } else if (path[i] == kReturnId) {
+      if (stack.size() > 1)
+        stack.pop_back();
+    } else if (path[i] >= 0) {
+      top.last = path[i];
+    }
+  }
+}
+
+
 bool CfgHeuristicSearch::DoSearch(int depth,
 				  int iters,
 				  int pos,
@@ -990,12 +2655,17 @@ bool CfgHeuristicSearch::DoSearch(int depth,
   { // Compute (and sort by) the scores.
     random_shuffle(scoredBranches.begin(), scoredBranches.end());
     map<branch_id_t,int> seen;
+    vector<size_t> ret_dist;
+    ReturnDistances(prev_ex, &ret_dist);
     for (size_t i = 0; i < scoredBranches.size(); i++) {
       size_t idx = scoredBranches[i].first;
       size_t branch_idx = prev_ex.path().constraints_idx()[idx];
       branch_id_t bid = paired_branch_[prev_ex.path().branches()[branch_idx]];
 
-      scoredBranches[i].second = dist_[bid] + seen[bid];
+      // The paired branch may be closer to an uncovered branch by way of
+      // returning from its function.
+      size_t dist = min(dist_[bid], exit_dist_[bid] + ret_dist[idx]);
+      scoredBranches[i].second = dist + seen[bid];
       seen[bid] += 1;
 
       /*
@@ -1008,29 +2678,37 @@ bool CfgHeuristicSearch::DoSearch(int depth,
       */
     }
   }
-  stable_sort(scoredBranches.begin(), scoredBranches.end(), ScoredBranchComp());
+  RankBranches(prev_ex, &scoredBranches);
 
   // Solve.
   SymbolicExecution cur_ex;
   vector<value_t> input;
   for (size_t i = 0; i < scoredBranches.size(); i++) {
-    if ((iters <= 0) || (scoredBranches[i].second > maxDist))
+    if (iters <= 0)
       return false;
+    if (scoredBranches[i].second > maxDist)
+      continue;
 
     num_inner_solves_ ++;
 
-    if (!SolveAtBranch(prev_ex, scoredBranches[i].first, &input)) {
-      num_inner_unsats_ ++;
+    solve_result_t result = SolveAtBranch(prev_ex, scoredBranches[i].first, &input);
+    if (result != results::SAT) {
+      if (result == results::UNKNOWN) {
+        num_inner_unknowns_ ++;
+      } else {
+        num_inner_unsats_ ++;
+      }
       continue;
     }
 
-    RunProgram(input, &cur_ex);
+    if (!RunProgram(input, &cur_ex))
+      return false;
     iters--;
 
     size_t b_idx = prev_ex.path().constraints_idx()[scoredBranches[i].first];
     branch_id_t bid = paired_branch_[prev_ex.path().branches()[b_idx]];
     set<branch_id_t> new_branches;
-    bool found_new_branch = UpdateCoverage(cur_ex, &new_branches);
+    bool found_new_branch = UpdateSourceCoverage(cur_ex, &new_branches);
     bool prediction_failed = !CheckPrediction(prev_ex, cur_ex, b_idx);
 
 
@@ -1171,7 +2849,7 @@ bool CfgHeuristicSearch::FindAlongCfg(size_t i, unsigned int dist,
   // following '*' are : 1, 4, 5, 8, and 9.
   vector<size_t> idxs;
   { size_t pos = i + 1;
-    CollectNextBranches(path, &pos, &idxs);
+    CollectNextBranches(ex.path(), &pos, &idxs);
   }
 
   for (vector<size_t>::const_iterator j = idxs.begin(); j != idxs.end(); ++j) {
@@ -1184,7 +2862,7 @@ bool CfgHeuristicSearch::FindAlongCfg(size_t i, unsigned int dist,
 
 
 bool CfgHeuristicSearch::SolveAlongCfg(size_t i, unsigned int max_dist,
-				       const SymbolicExecution& prev_ex) {
+				       SymbolicExecution& prev_ex) {
   num_solves_ ++;
 
   fprintf(stderr, "SolveAlongCfg(%zu,%u)\n", i, max_dist);
@@ -1201,7 +2879,7 @@ bool CfgHeuristicSearch::SolveAlongCfg(size_t i, unsigned int max_dist,
   bool found_path = false;
   vector<size_t> idxs;
   { size_t pos = i + 1;
-    CollectNextBranches(path, &pos, &idxs);
+    CollectNextBranches(prev_ex.path(), &pos, &idxs);
     // fprintf(stderr, "Branches following %d:", path[i]);
     for (size_t j = 0; j < idxs.size(); j++) {
       // fprintf(stderr, " %d(%u,%u,%u)", path[idxs[j]], idxs[j],
@@ -1239,6 +2917,10 @@ bool CfgHeuristicSearch::SolveAlongCfg(size_t i, unsigned int max_dist,
 	num_solve_successes_ ++;
 	return true;
       }
+      if (prev_ex.path().branches().empty()) {
+	// (It could not be resumed -- see ResumeExecution.)
+	return false;
+      }
     }
 
     // Find the constraint corresponding to branch idxs[*j].
@@ -1258,12 +2940,18 @@ bool CfgHeuristicSearch::SolveAlongCfg(size_t i, unsigned int max_dist,
     if(dist_[paired_branch_[path[*j]]] <= max_dist) {
       num_solve_sat_attempts_ ++;
       // The paired branch is along a shortest path, so force.
-      if (!SolveAtBranch(prev_ex, c_idx, &input)) {
-	num_solve_unsats_ ++;
+      solve_result_t result = SolveAtBranch(prev_ex, c_idx, &input);
+      if (result != results::SAT) {
+	if (result == results::UNKNOWN) {
+	  num_solve_unknowns_ ++;
+	} else {
+	  num_solve_unsats_ ++;
+	}
 	continue;
       }
-      RunProgram(input, &cur_ex);
-      if (UpdateCoverage(cur_ex)) {
+      if (!RunProgram(input, &cur_ex))
+	return false;
+      if (UpdateSourceCoverage(cur_ex)) {
 	num_solve_successes_ ++;
 	success_ex_.Swap(cur_ex);
 	return true;
@@ -1273,40 +2961,37 @@ bool CfgHeuristicSearch::SolveAlongCfg(size_t i, unsigned int max_dist,
 	continue;
       }
 
-      // Recurse.
+      // Recurse (suspending prev_ex meanwhile).
       num_solve_recurses_ ++;
+      size_t path_hash;
+      size_t kept = SuspendExecution(&prev_ex, &path_hash);
       if (SolveAlongCfg(*j, max_dist-1, cur_ex)) {
 	num_solve_successes_ ++;
+	DiscardExecution(kept);
 	return true;
       }
+      if (!ResumeExecution(kept, path_hash, &prev_ex))
+	return false;
     }
   }
 
   return false;
 }
 
-void CfgHeuristicSearch::SkipUntilReturn(const vector<branch_id_t> path, size_t* pos) {
-  while ((*pos < path.size()) && (path[*pos] != kReturnId)) {
-    if (path[*pos] == kCallId) {
-      (*pos)++;
-      SkipUntilReturn(path, pos);
-      if (*pos >= path.size())
-	return;
-      assert(path[*pos] == kReturnId);
-    }
-    (*pos)++;
-  }
+void CfgHeuristicSearch::SkipUntilReturn(const SymbolicPath& path, size_t* pos) {
+  *pos = path.FrameEnd(*pos);
 }
 
 void CfgHeuristicSearch::CollectNextBranches
-(const vector<branch_id_t>& path, size_t* pos, vector<size_t>* idxs) {
+(const SymbolicPath& sym_path, size_t* pos, vector<size_t>* idxs) {
+  const vector<branch_id_t>& path = sym_path.branches();
   // fprintf(stderr, "Collect(%u,%u,%u)\n", path.size(), *pos, idxs->size());
 
   // Eat an arbitrary sequence of call-returns, collecting inside each one.
   while ((*pos < path.size()) && (path[*pos] == kCallId)) {
     (*pos)++;
-    CollectNextBranches(path, pos, idxs);
-    SkipUntilReturn(path, pos);
+    CollectNextBranches(sym_path, pos, idxs);
+    SkipUntilReturn(sym_path, pos);
     if (*pos >= path.size())
       return;
     assert(path[*pos] == kReturnId);
@@ -1325,7 +3010,7 @@ void CfgHeuristicSearch::CollectNextBranches
   /*
   if ((*pos < path.size()) && (path[*pos] == kReturnId)) {
     (*pos)++;
-    CollectNextBranches(path, pos, idxs);
+    CollectNextBranches(sym_path, pos, idxs);
   }
   */
 }
@@ -1343,13 +3028,14 @@ bool CfgHeuristicSearch::DoBoundedBFS(int i, int depth, const SymbolicExecution&
   vector<value_t> input;
   const vector<SymbolicPred*>& constraints = prev_ex.path().constraints();
   for (size_t j = static_cast<size_t>(i); j < constraints.size(); j++) {
-    if (!SolveAtBranch(prev_ex, j, &input)) {
+    if (SolveAtBranch(prev_ex, j, &input) != results::SAT) {
       continue;
     }
 
-    RunProgram(input, &cur_ex);
+    if (!RunProgram(input, &cur_ex))
+      return false;
     iters_left_--;
-    if (UpdateCoverage(cur_ex)) {
+    if (UpdateSourceCoverage(cur_ex)) {
       success_ex_.Swap(cur_ex);
       return true;
     }
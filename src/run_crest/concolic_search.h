@@ -11,11 +11,15 @@
 #ifndef RUN_CREST_CONCOLIC_SEARCH_H__
 #define RUN_CREST_CONCOLIC_SEARCH_H__
 
+#include <deque>
+#include <istream>
 #include <map>
+#include <ostream>
 #include <vector>
 #include <ext/hash_map>
 #include <ext/hash_set>
 #include <time.h>
+#include <utility>
 
 /*
 #include <sys/types.h>
@@ -25,8 +29,18 @@
 
 #include "base/basic_types.h"
 #include "base/symbolic_execution.h"
-
+#include "run_crest/branch_graph.h"
+#include "run_crest/branch_set.h"
+#include "run_crest/corpus.h"
+#include "run_crest/cost_model.h"
+#include "run_crest/execution_tree.h"
+#include "run_crest/solver_pool.h"
+
+using std::deque;
+using std::istream;
 using std::map;
+using std::ostream;
+using std::pair;
 using std::vector;
 using __gnu_cxx::hash_map;
 using __gnu_cxx::hash_set;
@@ -40,12 +54,105 @@ class Search {
 
   virtual void Run() = 0;
 
+  // Use 'num_workers' solver processes to solve batches of branches in
+  // parallel.  (Zero, the default, solves everything in-process.)
+  void SetSolverWorkers(int num_workers);
+
+  // Use the named solver backend (see Solver::Create).  Returns false
+  // if there is no such backend.
+  bool SetSolver(const string& name);
+
+  // Give up on each solver query after 'seconds' (zero, the default,
+  // for no limit).  Queries which run out of time are queued to be
+  // retried later with a bigger budget -- see RetryTimedOutBranches.
+  void SetSolverTimeout(double seconds);
+
+  // Dump every solver query, with its result and latency, to directory
+  // 'dir' (see Solver::set_dump_dir), creating it if necessary.
+  void SetQueryDumpDir(const string& dir);
+
+  // Skip (and queue for retry) all solver queries while the solver has
+  // used more than 'share' of the wall-clock time of each solver process.
+  void SetMaxSolverShare(double share);
+
+  // Write a checkpoint of the search state to the file "checkpoint"
+  // every 'seconds' (zero, the default, for never).
+  void SetCheckpointInterval(double seconds);
+
+  // Restores the search state from the file "checkpoint".  Returns false
+  // if there is no checkpoint.  Must be called before Run().
+  bool Resume();
+
+  // Budgets, in addition to the number of iterations: the search stops
+  // once it has run for 'seconds' of wall-clock time, or spent 'seconds'
+  // in the solver, or grown to 'megabytes' of memory.  (Zero, the
+  // default, for no limit.)
+  void SetMaxTime(double seconds);
+  void SetMaxSolverTime(double seconds);
+  void SetMaxMemory(size_t megabytes);
+
+  // Limit the execution tree (see tree_) to 'megabytes' of memory.
+  void SetMaxTreeMemory(size_t megabytes);
+
+  // Keep suspended executions (see SuspendExecution) in memory only up
+  // to 'megabytes' in all, re-running the rest when they are resumed.
+  // (By default, all are kept.)
+  void SetFrontierMemory(size_t megabytes);
+
+  // Save each input which covers new branches to the corpus in
+  // directory 'dir' (see Corpus).
+  void SetCorpusDir(const string& dir);
+
+  // Sets the (original) ids of the branches to aim for: the search stops
+  // once they have all been covered, and reports when each was first
+  // covered.  Returns false if any id is not a branch of the program.
+  virtual bool SetTargets(const vector<branch_id_t>& ids);
+
+  // Runs each input in the corpus in directory 'dir', up to 'jobs' at a
+  // time, recording only the coverage of each run.  The inputs which
+  // covered new branches become the starting points of the search (see
+  // NextStartingInput).  Called before Run().
+  void Seed(const string& dir, int jobs);
+
+  // Writes the final coverage, checkpoint (if enabled), and a report of
+  // the search to the file "report" (and stderr).  Called once Run()
+  // has returned.
+  void Finish();
+
+  // Runs the search for a slice of at most 'iterations' more iterations
+  // (e.g. as one of the strategies of a PortfolioSearch).  Returns false
+  // once the search has finished (or run out of budget).
+  //
+  // A search stopped at the end of a slice keeps its state for the next:
+  // -dfs its stack, -generational its queue, and the others the round
+  // (from a starting input) under way, with its current execution.  But
+  // the recursive searches of -cfg and -cfg_baseline, and the local
+  // searches of -hybrid, cut short by the end of a slice start over (from
+  // that execution) in the next -- though without repeating negations
+  // already tried.
+  bool RunSlice(int iterations);
+
+  // Adds the branches covered by 'other' (a search of the same program)
+  // to those covered by this search.  Returns the number added.
+  size_t ImportCoverage(const Search& other);
+
+  int num_iterations() const { return num_iters_; }
+  double program_time() const { return program_time_; }
+  Solver::Stats solver_stats() const { return solver_pool_->stats(); }
+
  protected:
+  // Branches are numbered densely, from 1 to max_branch_ - 1, in the
+  // order of the "branches" file.  Paths are translated from the
+  // instrumented program's (sparse) ids as they are read, and back for
+  // the "coverage" file and the corpus.
+  vector<branch_id_t> raw_branch_;    // Dense id -> original id.
+  vector<branch_id_t> dense_branch_;  // Original id -> dense id (or 0).
+
   vector<branch_id_t> branches_;
   vector<branch_id_t> paired_branch_;
   vector<function_id_t> branch_function_;
-  vector<bool> covered_;
-  vector<bool> total_covered_;
+  BranchSet covered_;
+  BranchSet total_covered_;
   branch_id_t max_branch_;
   unsigned int num_covered_;
   unsigned int total_num_covered_;
@@ -58,28 +165,218 @@ class Search {
 
   time_t start_time_;
 
-  typedef vector<branch_id_t>::const_iterator BranchIt;
+  // The target branches (see SetTargets), if any, and how many have been
+  // covered.
+  vector<branch_id_t> targets_;
+  BranchSet is_target_;
+  size_t num_targets_hit_;
+
+  // Every path explored, and every negation tried, so far.  (Not saved
+  // in checkpoints -- a resumed search starts with an empty tree.)
+  ExecutionTree tree_;
 
-  bool SolveAtBranch(const SymbolicExecution& ex,
-		     size_t branch_idx,
-		     vector<value_t>* input);
+  typedef vector<branch_id_t>::const_iterator BranchIt;
 
+  // Returns UNKNOWN if the query timed out or was skipped, in which
+  // case it has been queued for a retry.  Returns UNSAT, without
+  // solving, if the execution tree shows that the negation is
+  // infeasible or has already been tried (see NegationTried).
+  solve_result_t SolveAtBranch(const SymbolicExecution& ex,
+			       size_t branch_idx,
+			       vector<value_t>* input);
+
+  // Solves at each of the constraints idxs[k] of 'ex' -- concurrently, if
+  // there are solver workers.  Results are in the same order as 'idxs'.
+  void SolveAtBranches(const SymbolicExecution& ex,
+                       const vector<size_t>& idxs,
+                       vector<solve_result_t>* solved,
+                       vector< vector<value_t> >* inputs);
+
+  // Retries the oldest queued query which timed out (or was skipped),
+  // with double its previous time limit, and runs the program on the
+  // solution (if any) into 'ex'.  Returns true if the program took the
+  // predicted path, with the negated constraint's index in 'branch_idx'.
+  bool RetryTimedOutBranch(SymbolicExecution* ex, size_t* branch_idx);
+
+  // Retries each of the currently queued queries once.
+  void RetryTimedOutBranches();
+
+  // Returns true if the negation of constraint 'branch_idx' of 'ex' has
+  // already been tried without reaching it (or found infeasible), or if
+  // everything below it has been explored.
+  bool NegationTried(const SymbolicExecution& ex, size_t branch_idx) const;
+
+  // Records that the input solved for the negation of constraint
+  // 'branch_idx' of 'ex' is queued to be run later.  (A solved input
+  // which is run right away needs no mark -- running it records the
+  // negation as explored, or CheckPrediction as divergent.)
+  void MarkInFlight(const SymbolicExecution& ex, size_t branch_idx);
+
+  size_t num_timed_out() const { return timed_out_.size(); }
+
+  // The number of queries worth handing to SolveAtBranches at once.
+  size_t solver_batch_size() const;
+
+  // Orders 'branches' -- pairs of a constraint index of 'ex' and a score
+  // (lower is better, e.g. a distance to new coverage) -- by expected
+  // new coverage per second, best first: the chance that the negation
+  // is satisfiable, over one plus the score, over the expected time to
+  // solve for it and run the program (see CostModel) -- halved for each
+  // failure of the branch since it last succeeded.
+  void RankBranches(const SymbolicExecution& ex,
+                    vector< pair<size_t,int> >* branches) const;
+
+  // Returns true if 'new_ex' took the path of 'old_ex' up to, and then
+  // the negation of, branch 'branch_idx'.  If not, the negation is
+  // recorded as divergent.
   bool CheckPrediction(const SymbolicExecution& old_ex,
 		       const SymbolicExecution& new_ex,
 		       size_t branch_idx);
 
-  void RunProgram(const vector<value_t>& inputs, SymbolicExecution* ex);
+  // Runs the program on 'inputs'.  Returns false, without running the
+  // program, once the search is out of budget -- the strategies then
+  // return from Run() as soon as they can.
+  bool RunProgram(const vector<value_t>& inputs, SymbolicExecution* ex);
+
+  // Suspends 'ex' while the search explores below it.  Under the
+  // frontier policy (see SetFrontierMemory), its path is either kept in
+  // memory, or freed -- keeping only its input -- and regenerated by
+  // ResumeExecution.  Returns the memory kept (zero if freed), and sets
+  // '*path_hash' to identify the path.
+  size_t SuspendExecution(SymbolicExecution* ex, size_t* path_hash);
+
+  // Resumes an execution suspended with 'kept' memory, re-running the
+  // program on its input if its path was freed.  Returns false, leaving
+  // 'ex' empty, if the search is out of budget or if the program took a
+  // different path than the one suspended.
+  bool ResumeExecution(size_t kept, size_t path_hash, SymbolicExecution* ex);
+
+  // Releases the memory kept for a suspended execution which will not be
+  // resumed.
+  void DiscardExecution(size_t kept) { frontier_memory_used_ -= kept; }
+
+  // Returns true if any of the budgets has been used up (or if there is
+  // nothing left to explore).
+  bool BudgetExhausted();
+
   bool UpdateCoverage(const SymbolicExecution& ex);
   bool UpdateCoverage(const SymbolicExecution& ex,
 		      set<branch_id_t>* new_branches);
 
+  // Records 'branches' (e.g. the path of an execution) as covered.
+  bool AddCoverage(const vector<branch_id_t>& branches,
+                   set<branch_id_t>* new_branches);
+
+  // Called by AddCoverage for each branch it newly marks as covered.
+  virtual void BranchCovered(branch_id_t b) { }
+
+  // Counts 'n' iterations run elsewhere (e.g. by distributed workers).
+  // Returns false once the budget is used up.
+  bool CountIterations(int n);
+  int iterations_left() const { return max_iters_ - num_iters_; }
+
+  // Counts time spent running the program and solving elsewhere (e.g.
+  // by the strategies of a portfolio), towards the budgets and report.
+  void CountWorkTime(double program_time, const Solver::Stats& stats);
+
   void RandomInput(const map<var_t,type_t>& vars, vector<value_t>* input);
 
+  // The input on which to start (or restart) the search: the next seed
+  // input, or, once those have run out, an empty (i.e. random) input.
+  vector<value_t> NextStartingInput();
+  size_t num_seed_inputs() const { return seed_inputs_.size(); }
+
+  // Writes a checkpoint, if one is due.  Strategies call this only at
+  // points where everything needed to continue is in their SaveState.
+  void MaybeCheckpoint();
+
+  // Save and restore the state of the search.  Strategies which keep
+  // state of their own extend these (calling the Search versions
+  // first).  LoadState returns false if the state is malformed.
+  virtual void SaveState(ostream& out) const;
+  virtual bool LoadState(istream& in);
+
  private:
   const string program_;
   const int max_iters_; 
   int num_iters_;
 
+  double max_time_;
+  double max_solver_time_;
+  size_t max_memory_;
+  const char* stop_reason_;  // Which budget ran out (if any).
+  int last_target_iter_;     // When the last target was hit (or -1).
+  double last_target_time_;
+  int slice_end_;            // The iteration ending the slice (see RunSlice).
+  double program_time_;
+
+  Solver* solver_;
+  SolverPool* solver_pool_;
+  double solver_timeout_;
+  double max_solver_share_;
+  string query_dump_dir_;
+  unsigned int num_skipped_solves_;
+  Solver::Stats other_solver_stats_;  // (See CountWorkTime.)
+  CostModel cost_model_;
+
+  // What has come of the negations of each branch (by dense id) over the
+  // whole search.  A failure is an UNSAT or timed-out query, or a run
+  // which diverged from the predicted path; a success is a run which
+  // took it.
+  struct BranchOutcomes {
+    unsigned int attempts;
+    unsigned int unsat;
+    unsigned int timeouts;
+    unsigned int divergent;
+    unsigned int successes;
+    unsigned int failures;  // Since the last success.
+  };
+  vector<BranchOutcomes> outcomes_;
+
+  size_t max_frontier_memory_;
+  size_t frontier_memory_used_;
+  unsigned int num_reexecutions_;
+  unsigned int num_reexecutions_diverged_;
+
+  Corpus* corpus_;
+  string corpus_dir_;
+  deque< vector<value_t> > seed_inputs_;
+
+  // A query to retry: a copy of the execution, truncated after the
+  // constraint to negate.
+  struct TimedOutQuery {
+    SymbolicExecution* ex;
+    double timeout;
+    int attempts;
+  };
+  deque<TimedOutQuery> timed_out_;
+
+  double checkpoint_interval_;
+  time_t last_checkpoint_;
+  // The random number generator is reseeded at each checkpoint, so that
+  // a resumed search continues with the same random choices.
+  unsigned int rng_seed_;
+
+  void WriteCheckpoint();
+
+  bool SolverOverBudget() const;
+  bool PathMatches(const SymbolicExecution& old_ex,
+                   const SymbolicExecution& new_ex,
+                   size_t branch_idx) const;
+  void ScheduleRetry(const SymbolicExecution& ex, size_t branch_idx,
+                     double timeout, int attempts);
+  // Adds the queries at constraints 'idxs' of 'ex', which took
+  // 'seconds' each, to the cost model and the outcomes of their
+  // branches.
+  void RecordSolves(const SymbolicExecution& ex, const vector<size_t>& idxs,
+                    const vector<solve_result_t>& results,
+                    const vector<double>& seconds);
+  void RecordOutcome(branch_id_t b, bool success);
+  // The branch which negating constraint 'i' of 'ex' aims for.
+  branch_id_t NegatedBranch(const SymbolicExecution& ex, size_t i) const {
+    return paired_branch_[ex.path().branches()[ex.path().constraints_idx()[i]]];
+  }
+
   /*
   struct sockaddr_un sock_;
   int sockd_;
@@ -100,10 +397,54 @@ class BoundedDepthFirstSearch : public Search {
 
   virtual void Run();
 
+ protected:
+  virtual void SaveState(ostream& out) const;
+  virtual bool LoadState(istream& in);
+
  private:
   int max_depth_;
 
-  void DFS(size_t pos, int depth, SymbolicExecution& prev_ex);
+  // The stack of the DFS (kept explicitly, rather than by recursion, as
+  // it can be as deep as max_depth_): at each level, the execution being
+  // explored -- suspended while a child of it is explored -- the index of
+  // (and depth left at) the constraint being negated, and the batch of
+  // negations last solved.  A child shares the constraints of the prefix
+  // it has in common with its parent (see SymbolicPath::SharePrefix), as
+  // long as the parent's path is kept while the child is explored.
+  struct Frame {
+    SymbolicExecution* ex;  // (Owned.)
+    size_t pos;
+    int depth;
+    bool suspended;
+    size_t kept;            // (See SuspendExecution.)
+    size_t path_hash;
+    vector<size_t> idxs;
+    vector<solve_result_t> solved;
+    vector< vector<value_t> > inputs;
+  };
+  vector<Frame> frames_;
+
+  // The position to resume from (see LoadState): the input, position
+  // and depth left at each level of the saved stack.
+  struct SavedFrame {
+    vector<value_t> input;
+    size_t pos;
+    int depth;
+  };
+  vector<SavedFrame> resume_;
+
+  // Searches below 'ex' (from constraint 'pos'), taking over its path.
+  void DFS(size_t pos, int depth, SymbolicExecution& ex);
+
+  // Searches from the frames on the stack, until it is empty (or the
+  // search is out of budget).
+  void ContinueDFS();
+
+  // Pushes 'ex' (taking ownership), suspending the execution below it.
+  void PushFrame(SymbolicExecution* ex, size_t pos, int depth);
+
+  // Pops the top frame, moving the frame below past the popped child.
+  void PopFrame();
 };
 
 
@@ -131,6 +472,7 @@ class RandomInputSearch : public Search {
   
  private:
   SymbolicExecution ex_;
+  bool started_;  // Whether the inputs have been found (see RunSlice).
 };
 
 
@@ -144,6 +486,11 @@ class RandomSearch : public Search {
  private:
   SymbolicExecution ex_;
 
+  // Whether a round (from a starting input) is under way, and how many
+  // iterations it has gone without new coverage -- kept between slices.
+  bool in_round_;
+  int count_;
+
   void SolveUncoveredBranches(size_t i, int depth,
                               const SymbolicExecution& prev_ex);
 
@@ -161,10 +508,12 @@ class UniformRandomSearch : public Search {
  private:
   SymbolicExecution prev_ex_;
   SymbolicExecution cur_ex_;
+  bool started_;  // Whether prev_ex_ holds a path (see RunSlice).
 
   size_t max_depth_;
 
-  void DoUniformRandomPath();
+  // Returns false if no program runs were made.
+  bool DoUniformRandomPath();
 };
 
 
@@ -183,6 +532,12 @@ class HybridSearch : public Search {
   bool RandomStep(SymbolicExecution* ex, size_t start, size_t end);
 
   int step_size_;
+
+  // The round under way (if any), and the execution point its local
+  // searches have reached -- kept between slices.
+  bool in_round_;
+  SymbolicExecution ex_;
+  size_t pos_;
 };
 
 
@@ -210,29 +565,103 @@ class CfgBaselineSearch : public Search {
   virtual void Run();
 
  private:
+  SymbolicExecution ex_;
   SymbolicExecution success_ex_;
+  bool in_round_;  // Whether a round is under way (see RunSlice).
 
   bool DoSearch(int depth, int iters, int pos, const SymbolicExecution& prev_ex);
 };
 
 
+// Generational search (as in SAGE): each execution taken off the queue
+// is expanded all at once, by solving for the negation of every
+// constraint past its bound and running the program on all of the
+// resulting inputs.  The children are scored by the number of new
+// branches they cover, and queued (best first) with bounds just past
+// the constraint that was negated to produce them.
+class GenerationalSearch : public Search {
+ public:
+  GenerationalSearch(const string& program, int max_iterations);
+  virtual ~GenerationalSearch();
+
+  virtual void Run();
+
+ protected:
+  virtual void SaveState(ostream& out) const;
+  virtual bool LoadState(istream& in);
+
+ private:
+  struct Child {
+    SymbolicExecution* ex;
+    size_t bound;
+  };
+
+  // Keyed by (-score, sequence number): best first, oldest first.
+  typedef map<pair<int,unsigned>,Child> ChildQueue;
+  ChildQueue queue_;
+  unsigned num_children_;
+
+  static const size_t kMaxQueueSize = 1000;
+
+  // Runs the children of 'ex' -- the negations of its constraints from
+  // 'bound' on -- and queues them.  Returns false, with 'bound' at the
+  // first child not run, if the search runs out of budget.
+  bool Expand(const SymbolicExecution& ex, size_t* bound);
+  void Enqueue(SymbolicExecution* ex, size_t bound, int score);
+};
+
+
 class CfgHeuristicSearch : public Search {
  public:
   CfgHeuristicSearch(const string& program, int max_iterations);
   virtual ~CfgHeuristicSearch();
 
+  // With targets, the distances are to the uncovered targets, rather
+  // than to every branch not covered in the current round.
+  virtual bool SetTargets(const vector<branch_id_t>& ids);
+
   virtual void Run();
 
+ protected:
+  virtual void SaveState(ostream& out) const;
+  virtual bool LoadState(istream& in);
+
  private:
-  typedef vector<branch_id_t> nbhr_list_t;
-  vector<nbhr_list_t> cfg_;
-  vector<nbhr_list_t> cfg_rev_;
+  typedef BranchGraph::NbhrIt NbhrIt;
+  BranchGraph cfg_;
   vector<size_t> dist_;
 
+  // The branches covered since dist_ was last updated, and scratch space
+  // for the update.
+  vector<branch_id_t> newly_covered_;
+  vector<bool> affected_;
+
+  // dist_ follows CFG edges into called functions, but not back out of
+  // them.  To account for the calling context of a branch, we also keep:
+  //   exit_dist_[b]: the fewest branches, after b, before b's function
+  //     returns;
+  //   entry_branches_[f]: the branches which can come first in f;
+  //   entry_exit_dist_[f]: the fewest branches from the entry of f to
+  //     its return;
+  //   entry_dist_[f]: the distance from the entry of f to an uncovered
+  //     branch (computed when needed, and valid while its version is
+  //     dist_version_).
+  vector<size_t> exit_dist_;
+  vector< vector<branch_id_t> > entry_branches_;
+  vector<size_t> entry_exit_dist_;
+  vector<size_t> entry_dist_;
+  vector<unsigned int> entry_dist_version_;
+  unsigned int dist_version_;
+
   static const size_t kInfiniteDistance = 10000;
 
   int iters_left_;
 
+  // The execution from which the current round is searching.  (If we
+  // resume in the middle of a round, we continue from it.)
+  SymbolicExecution ex_;
+  bool in_round_;
+
   SymbolicExecution success_ex_;
 
   // Stats.
@@ -243,6 +672,7 @@ class CfgHeuristicSearch : public Search {
   unsigned num_inner_nonzero_successes_;
   unsigned num_inner_recursive_successes_;
   unsigned num_inner_unsats_;
+  unsigned num_inner_unknowns_;
   unsigned num_inner_pred_fails_;
 
   unsigned num_top_solves_;
@@ -252,25 +682,52 @@ class CfgHeuristicSearch : public Search {
   unsigned num_solve_successes_;
   unsigned num_solve_sat_attempts_;
   unsigned num_solve_unsats_;
+  unsigned num_solve_unknowns_;
   unsigned num_solve_recurses_;
   unsigned num_solve_pred_fails_;
   unsigned num_solve_all_concrete_;
   unsigned num_solve_no_paths_;
 
+  virtual void BranchCovered(branch_id_t b);
+
+  // Whether b is a source of the distances (at distance 0).
+  bool IsSource(branch_id_t b) const {
+    if (targets_.empty())
+      return !covered_[b];
+    return is_target_[b] && !total_covered_[b];
+  }
+
+  // Updates the coverage by 'ex', returning whether (and which of) the
+  // newly covered branches were sources of the distances.
+  bool UpdateSourceCoverage(const SymbolicExecution& ex,
+                            set<branch_id_t>* new_branches = NULL);
+
+  // Computes dist_ from scratch, or updates it for just the branches
+  // covered since the last computation or update.
+  void ComputeBranchDistances();
   void UpdateBranchDistances();
+
+  void ComputeFunctionSummaries();
+  size_t EntryDistance(function_id_t f);
+  size_t ContinueDistance(branch_id_t b) const;
+
+  // Computes, for each constraint of 'ex', the distance to an uncovered
+  // branch from the point at which the function containing the
+  // constraint returns -- one step per call frame along the path.
+  void ReturnDistances(const SymbolicExecution& ex, vector<size_t>* ret_dist);
   void PrintStats();
   bool DoSearch(int depth, int iters, int pos, int maxDist, const SymbolicExecution& prev_ex);
   bool DoBoundedBFS(int i, int depth, const SymbolicExecution& prev_ex);
-  void SkipUntilReturn(const vector<branch_id_t> path, size_t* pos);
+  void SkipUntilReturn(const SymbolicPath& path, size_t* pos);
 
   bool FindAlongCfg(size_t i, unsigned int dist,
 		    const SymbolicExecution& ex,
 		    const set<branch_id_t>& bs);
 
   bool SolveAlongCfg(size_t i, unsigned int max_dist,
-		     const SymbolicExecution& prev_ex);
+		     SymbolicExecution& prev_ex);
 
-  void CollectNextBranches(const vector<branch_id_t>& path,
+  void CollectNextBranches(const SymbolicPath& path,
 			   size_t* pos, vector<size_t>* idxs);
 
   size_t MinCflDistance(size_t i,
@@ -0,0 +1,219 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "run_crest/corpus.h"
+
+using std::max;
+using std::sort;
+using std::unique;
+
+namespace crest {
+
+namespace {
+
+// Minimize once the corpus has doubled in size (and is at least this
+// big), so that the cost of minimizing is amortized over the inputs.
+const size_t kMinMinimizeSize = 16;
+
+template <typename T>
+bool ReadVector(FILE* f, vector<T>* v) {
+  unsigned int len;
+  if (fread(&len, sizeof(len), 1, f) != 1)
+    return false;
+  v->resize(len);
+  return (len == 0) || (fread(&v->front(), sizeof(T), len, f) == len);
+}
+
+template <typename T>
+bool WriteVector(FILE* f, const vector<T>& v) {
+  unsigned int len = v.size();
+  if (fwrite(&len, sizeof(len), 1, f) != 1)
+    return false;
+  return (len == 0) || (fwrite(&v.front(), sizeof(T), len, f) == len);
+}
+
+// Orders entries by decreasing coverage, then increasing input length,
+// then age.
+struct EntryOrder {
+  const vector<Corpus::Entry>* entries;
+  bool operator()(size_t a, size_t b) const {
+    const Corpus::Entry& x = (*entries)[a];
+    const Corpus::Entry& y = (*entries)[b];
+    if (x.covered.size() != y.covered.size())
+      return (x.covered.size() > y.covered.size());
+    if (x.input.size() != y.input.size())
+      return (x.input.size() < y.input.size());
+    return (x.id < y.id);
+  }
+};
+
+}  // namespace
+
+
+Corpus::Corpus(const string& dir)
+  : dir_(dir), next_id_(0), minimized_size_(0) {
+
+  if ((mkdir(dir_.c_str(), 0777) != 0) && (errno != EEXIST)) {
+    fprintf(stderr, "Failed to create %s.\n", dir_.c_str());
+    perror("Error: ");
+    exit(-1);
+  }
+
+  // Read in any existing inputs.
+  DIR* d = opendir(dir_.c_str());
+  if (!d) {
+    fprintf(stderr, "Failed to open %s.\n", dir_.c_str());
+    perror("Error: ");
+    exit(-1);
+  }
+  vector<unsigned int> ids;
+  struct dirent* ent;
+  while ((ent = readdir(d)) != NULL) {
+    unsigned int id;
+    char c;
+    if (sscanf(ent->d_name, "input-%u%c", &id, &c) == 1)
+      ids.push_back(id);
+  }
+  closedir(d);
+
+  sort(ids.begin(), ids.end());
+  for (size_t i = 0; i < ids.size(); i++) {
+    Entry e;
+    if (!ReadEntry(ids[i], &e)) {
+      fprintf(stderr, "Skipping malformed corpus input %s.\n",
+              FileName(ids[i]).c_str());
+      continue;
+    }
+    entries_.push_back(e);
+    next_id_ = ids[i] + 1;
+  }
+  minimized_size_ = entries_.size();
+
+  if (!entries_.empty())
+    fprintf(stderr, "Read %zu inputs from corpus %s.\n",
+            entries_.size(), dir_.c_str());
+}
+
+
+Corpus::~Corpus() { }
+
+
+void Corpus::Add(const vector<value_t>& input,
+                 const vector<branch_id_t>& new_branches,
+                 const vector<branch_id_t>& path) {
+  entries_.push_back(Entry());
+  Entry& e = entries_.back();
+  e.id = next_id_++;
+  e.input = input;
+  e.new_branches = new_branches;
+  // (Skipping the markers for function calls and returns.)
+  for (size_t i = 0; i < path.size(); i++) {
+    if (path[i] > 0)
+      e.covered.push_back(path[i]);
+  }
+  sort(e.covered.begin(), e.covered.end());
+  e.covered.erase(unique(e.covered.begin(), e.covered.end()), e.covered.end());
+  WriteEntryOrDie(e);
+
+  if (entries_.size() >= 2 * max(minimized_size_, kMinMinimizeSize))
+    Minimize();
+}
+
+
+void Corpus::Minimize() {
+  vector<size_t> order(entries_.size());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  EntryOrder cmp;
+  cmp.entries = &entries_;
+  sort(order.begin(), order.end(), cmp);
+
+  // Greedily keep each input which covers some branch not covered by
+  // the inputs kept before it.
+  vector<bool> kept(entries_.size(), false);
+  vector<bool> covered;
+  for (size_t k = 0; k < order.size(); k++) {
+    const Entry& e = entries_[order[k]];
+    for (size_t j = 0; j < e.covered.size(); j++) {
+      branch_id_t b = e.covered[j];
+      if (b <= 0)
+        continue;
+      if (static_cast<size_t>(b) >= covered.size())
+        covered.resize(b + 1, false);
+      if (!covered[b]) {
+        covered[b] = true;
+        kept[order[k]] = true;
+      }
+    }
+  }
+
+  size_t n = 0;
+  for (size_t i = 0; i < entries_.size(); i++) {
+    if (kept[i]) {
+      if (n != i)
+        entries_[n] = entries_[i];
+      n++;
+    } else {
+      unlink(FileName(entries_[i].id).c_str());
+    }
+  }
+  if (n < entries_.size()) {
+    fprintf(stderr, "Minimized corpus from %zu to %zu inputs.\n",
+            entries_.size(), n);
+  }
+  entries_.resize(n);
+  minimized_size_ = n;
+}
+
+
+string Corpus::FileName(unsigned int id) const {
+  char buff[32];
+  snprintf(buff, sizeof(buff), "/input-%06u", id);
+  return dir_ + buff;
+}
+
+
+bool Corpus::ReadEntry(unsigned int id, Entry* e) const {
+  FILE* f = fopen(FileName(id).c_str(), "rb");
+  if (!f)
+    return false;
+  e->id = id;
+  bool ok = (ReadVector(f, &e->input)
+             && ReadVector(f, &e->new_branches)
+             && ReadVector(f, &e->covered));
+  fclose(f);
+  return ok;
+}
+
+
+void Corpus::WriteEntryOrDie(const Entry& e) const {
+  const string file = FileName(e.id);
+  FILE* f = fopen(file.c_str(), "wb");
+  if (!f
+      || !WriteVector(f, e.input)
+      || !WriteVector(f, e.new_branches)
+      || !WriteVector(f, e.covered)
+      || fclose(f)) {
+    fprintf(stderr, "Failed to write %s.\n", file.c_str());
+    perror("Error: ");
+    exit(-1);
+  }
+}
+
+}  // namespace crest
@@ -0,0 +1,80 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef RUN_CREST_CORPUS_H__
+#define RUN_CREST_CORPUS_H__
+
+#include <string>
+#include <vector>
+
+#include "base/basic_types.h"
+
+using std::string;
+using std::vector;
+
+namespace crest {
+
+//
+// A directory of test inputs, each of which covered new branches when
+// it was found.
+//
+// Each input is stored in its own file, "input-NNNNNN", holding (as
+// native 32- and 64-bit integers):
+//   the number of input values, and the values;
+//   the number of branches first covered by the input, and their ids;
+//   the number of distinct branches covered by the input, and their ids.
+//
+// The corpus is kept small by periodically dropping the inputs whose
+// coverage is subsumed by the other inputs (see Minimize).
+//
+class Corpus {
+ public:
+  struct Entry {
+    unsigned int id;
+    vector<value_t> input;
+    vector<branch_id_t> new_branches;
+    vector<branch_id_t> covered;  // Sorted.
+  };
+
+  // Opens (creating, if necessary) the corpus in directory 'dir', and
+  // reads any inputs already there.
+  explicit Corpus(const string& dir);
+  ~Corpus();
+
+  // Adds an input which newly covered 'new_branches', and which took
+  // the branches in 'path' (in any order, possibly repeated).
+  void Add(const vector<value_t>& input,
+           const vector<branch_id_t>& new_branches,
+           const vector<branch_id_t>& path);
+
+  // Drops the inputs whose covered branches are all covered by the
+  // other inputs.  (Inputs covering the most branches are kept first,
+  // with ties going to the shortest and then the oldest input.)
+  void Minimize();
+
+  size_t size() const { return entries_.size(); }
+  const vector<Entry>& entries() const { return entries_; }
+
+ private:
+  const string dir_;
+  vector<Entry> entries_;
+  unsigned int next_id_;
+
+  // The size of the corpus after the last minimization.
+  size_t minimized_size_;
+
+  string FileName(unsigned int id) const;
+  bool ReadEntry(unsigned int id, Entry* e) const;
+  void WriteEntryOrDie(const Entry& e) const;
+};
+
+}  // namespace crest
+
+#endif  // RUN_CREST_CORPUS_H__
@@ -0,0 +1,194 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <algorithm>
+#include <set>
+
+#include "run_crest/cost_model.h"
+
+using std::max;
+using std::set;
+
+namespace crest {
+
+namespace {
+
+// How much each new sample outweighs the last one in the fits, the
+// initial uncertainty of their weights, and the weight of each new
+// solve time in the average for its branch.
+const double kForgetting = 0.98;
+const double kInitialVariance = 1e4;
+const double kHistoryWeight = 0.2;
+
+// (Estimates are never below this many seconds.)
+const double kMinTime = 1e-5;
+
+size_t Find(vector<size_t>* parent, size_t v) {
+  while ((*parent)[v] != v) {
+    (*parent)[v] = (*parent)[(*parent)[v]];
+    v = (*parent)[v];
+  }
+  return v;
+}
+
+}  // namespace
+
+
+CostModel::Fit::Fit() {
+  for (int i = 0; i < kDim; i++) {
+    w_[i] = 0;
+    for (int j = 0; j < kDim; j++) {
+      p_[i][j] = (i == j) ? kInitialVariance : 0;
+    }
+  }
+}
+
+
+double CostModel::Fit::Predict(double x1, double x2) const {
+  return w_[0] + w_[1] * x1 + w_[2] * x2;
+}
+
+
+void CostModel::Fit::Add(double x1, double x2, double y) {
+  const double x[kDim] = { 1, x1, x2 };
+
+  // k = P x / (forgetting + x' P x)
+  double px[kDim];
+  double denom = kForgetting;
+  for (int i = 0; i < kDim; i++) {
+    px[i] = 0;
+    for (int j = 0; j < kDim; j++) {
+      px[i] += p_[i][j] * x[j];
+    }
+    denom += x[i] * px[i];
+  }
+
+  const double err = y - Predict(x1, x2);
+  for (int i = 0; i < kDim; i++) {
+    w_[i] += px[i] / denom * err;
+  }
+
+  // P = (P - k x' P) / forgetting.  (P is symmetric, so x' P = (P x)'.)
+  // (Forgetting lets P grow along any direction the samples do not
+  // vary in, so we only forget while P stays smaller than it started.)
+  double trace = 0;
+  for (int i = 0; i < kDim; i++) {
+    for (int j = 0; j < kDim; j++) {
+      p_[i][j] -= px[i] * px[j] / denom;
+    }
+    trace += p_[i][i];
+  }
+  if (trace / kForgetting <= kDim * kInitialVariance) {
+    for (int i = 0; i < kDim; i++) {
+      for (int j = 0; j < kDim; j++) {
+        p_[i][j] /= kForgetting;
+      }
+    }
+  }
+}
+
+
+CostModel::CostModel() { }
+
+
+void CostModel::ComputeSlices(const SymbolicExecution& ex, size_t n,
+                              vector<size_t>* slice_sizes,
+                              vector<size_t>* slice_vars) {
+  // The slice of each constraint is the component containing it, of
+  // the graph joining the variables which share a constraint -- over
+  // the constraints up to it.  So we add the constraints in order, to a
+  // union-find on the variables.
+  const size_t num_vars = ex.vars().empty() ? 0 : ex.vars().rbegin()->first + 1;
+  vector<size_t> parent(num_vars);
+  vector<size_t> num_constraints(num_vars, 0);
+  vector<size_t> num_comp_vars(num_vars, 1);
+  for (size_t v = 0; v < num_vars; v++) {
+    parent[v] = v;
+  }
+
+  slice_sizes->resize(n);
+  slice_vars->resize(n);
+  set<var_t> vars;
+  for (size_t i = 0; i < n; i++) {
+    vars.clear();
+    ex.path().constraints()[i]->AppendVars(&vars);
+    if (vars.empty()) {
+      (*slice_sizes)[i] = 1;
+      (*slice_vars)[i] = 0;
+      continue;
+    }
+
+    size_t root = Find(&parent, *vars.begin());
+    for (set<var_t>::const_iterator j = vars.begin(); j != vars.end(); ++j) {
+      size_t r = Find(&parent, *j);
+      if (r != root) {
+        parent[r] = root;
+        num_constraints[root] += num_constraints[r];
+        num_comp_vars[root] += num_comp_vars[r];
+      }
+    }
+    num_constraints[root]++;
+    (*slice_sizes)[i] = num_constraints[root];
+    (*slice_vars)[i] = num_comp_vars[root];
+  }
+}
+
+
+double CostModel::SolveTime(branch_id_t b, size_t slice_size,
+                            size_t slice_vars) const {
+  double t = max(solve_fit_.Predict(slice_size, slice_vars), kMinTime);
+  map<branch_id_t,BranchHistory>::const_iterator it = history_.find(b);
+  if (it != history_.end()) {
+    // Trust the branch's own history more as it grows.
+    const double n = it->second.num_sat + it->second.num_other;
+    t = (2 * t + n * it->second.solve_time) / (2 + n);
+  }
+  return t;
+}
+
+
+double CostModel::RunTime(size_t path_length) const {
+  return max(run_fit_.Predict(path_length, 0), kMinTime);
+}
+
+
+double CostModel::SatProbability(branch_id_t b) const {
+  map<branch_id_t,BranchHistory>::const_iterator it = history_.find(b);
+  if (it == history_.end())
+    return 0.5;
+  return ((it->second.num_sat + 1.0)
+          / (it->second.num_sat + it->second.num_other + 2.0));
+}
+
+
+void CostModel::RecordSolve(branch_id_t b, size_t slice_size,
+                            size_t slice_vars, solve_result_t result,
+                            double seconds) {
+  solve_fit_.Add(slice_size, slice_vars, seconds);
+
+  BranchHistory& h = history_[b];
+  if (h.num_sat + h.num_other == 0) {
+    h.solve_time = seconds;
+  } else {
+    h.solve_time += kHistoryWeight * (seconds - h.solve_time);
+  }
+  if (result == results::SAT) {
+    h.num_sat++;
+  } else {
+    h.num_other++;
+  }
+}
+
+
+void CostModel::RecordRun(size_t path_length, double seconds) {
+  run_fit_.Add(path_length, 0, seconds);
+}
+
+}  // namespace crest
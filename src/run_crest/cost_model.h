@@ -0,0 +1,87 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef RUN_CREST_COST_MODEL_H__
+#define RUN_CREST_COST_MODEL_H__
+
+#include <map>
+#include <vector>
+
+#include "base/basic_types.h"
+#include "base/solver.h"
+#include "base/symbolic_execution.h"
+
+using std::map;
+using std::vector;
+
+namespace crest {
+
+//
+// An online model of what it costs to negate a branch: the time to
+// solve for the negation, and to run the program on the solution.
+//
+// Solve time is fit (by recursive least squares, favoring recent
+// queries) to the size of the slice the solver sees -- the constraints
+// which transitively share variables with the negated one -- and to the
+// number of variables in it, and is averaged with the past solve times
+// of the branch.  Run time is fit to the length of the path.  The model
+// also keeps, for each branch, how often its negation was satisfiable.
+//
+class CostModel {
+ public:
+  CostModel();
+
+  // Computes, for each of the first 'n' constraints of 'ex', the size of
+  // its slice and the number of variables in it.
+  static void ComputeSlices(const SymbolicExecution& ex, size_t n,
+                            vector<size_t>* slice_sizes,
+                            vector<size_t>* slice_vars);
+
+  // The expected time (in seconds) to solve for branch 'b', with the
+  // given slice, and to run the program on a path of 'path_length'.
+  double SolveTime(branch_id_t b, size_t slice_size, size_t slice_vars) const;
+  double RunTime(size_t path_length) const;
+
+  // The estimated chance that solving for branch 'b' succeeds.
+  double SatProbability(branch_id_t b) const;
+
+  void RecordSolve(branch_id_t b, size_t slice_size, size_t slice_vars,
+                   solve_result_t result, double seconds);
+  void RecordRun(size_t path_length, double seconds);
+
+ private:
+  // A linear fit, by recursive least squares, of y to (1, x1, x2).
+  class Fit {
+   public:
+    Fit();
+    double Predict(double x1, double x2) const;
+    void Add(double x1, double x2, double y);
+
+   private:
+    static const int kDim = 3;
+    double w_[kDim];
+    double p_[kDim][kDim];
+  };
+
+  struct BranchHistory {
+    BranchHistory() : num_sat(0), num_other(0), solve_time(0) { }
+    unsigned num_sat;
+    unsigned num_other;
+    double solve_time;  // Average (weighting recent queries more).
+  };
+
+  Fit solve_fit_;
+  Fit run_fit_;
+  map<branch_id_t,BranchHistory> history_;
+};
+
+}  // namespace crest
+
+#endif  // RUN_CREST_COST_MODEL_H__
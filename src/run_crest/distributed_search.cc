@@ -0,0 +1,534 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <algorithm>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "run_crest/distributed_search.h"
+
+using std::min;
+
+namespace crest {
+
+namespace {
+
+//
+// Messages are a type byte, a 32-bit payload length, and the payload.
+//
+// Worker to coordinator:
+//   'R'  request for work
+//   'C'  iterations run (int) and newly covered branches (ints)
+//   'F'  donated work items
+// Coordinator to worker:
+//   'W'  work items
+//   'G'  branches newly covered (elsewhere)
+//   'D'  request to donate work
+//   'Q'  quit
+//
+
+// Larger messages are taken to be garbage, and drop the connection.
+const unsigned int kMaxMessageSize = 1 << 28;
+
+bool WriteFully(int fd, const void* buf, size_t len) {
+  const char* p = static_cast<const char*>(buf);
+  while (len > 0) {
+    ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool ReadFully(int fd, void* buf, size_t len) {
+  char* p = static_cast<char*>(buf);
+  while (len > 0) {
+    ssize_t n = read(fd, p, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (n == 0)
+      return false;
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool SendMessage(int fd, char type, const string& payload) {
+  string msg(1, type);
+  unsigned int len = payload.size();
+  msg.append((char*)&len, sizeof(len));
+  msg.append(payload);
+  return WriteFully(fd, msg.data(), msg.size());
+}
+
+bool ReceiveMessage(int fd, char* type, string* payload) {
+  unsigned int len;
+  if (!ReadFully(fd, type, 1) || !ReadFully(fd, &len, sizeof(len))
+      || (len > kMaxMessageSize))
+    return false;
+  payload->resize(len);
+  return (len == 0) || ReadFully(fd, &(*payload)[0], len);
+}
+
+void AppendInt(int x, string* s) {
+  s->append((char*)&x, sizeof(x));
+}
+
+bool ReadInt(const string& s, size_t* pos, int* x) {
+  if (*pos + sizeof(*x) > s.size())
+    return false;
+  memcpy(x, s.data() + *pos, sizeof(*x));
+  *pos += sizeof(*x);
+  return true;
+}
+
+void SerializeItems(const deque<WorkItem>& items, size_t begin, size_t end,
+                    string* s) {
+  AppendInt(end - begin, s);
+  for (size_t i = begin; i < end; i++) {
+    items[i].Serialize(s);
+  }
+}
+
+bool ParseItems(const string& s, vector<WorkItem>* items) {
+  size_t pos = 0;
+  int n;
+  if (!ReadInt(s, &pos, &n))
+    return false;
+  // (Each item takes at least three ints.)
+  if ((n < 0) || (static_cast<size_t>(n) > (s.size() - pos) / (3 * sizeof(int))))
+    return false;
+  items->resize(n);
+  for (int i = 0; i < n; i++) {
+    if (!(*items)[i].Parse(s, &pos))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+
+void WorkItem::Serialize(string* s) const {
+  AppendInt(bound, s);
+  AppendInt(target, s);
+  AppendInt(input.size(), s);
+  if (!input.empty())
+    s->append((char*)&input.front(), input.size() * sizeof(value_t));
+}
+
+
+bool WorkItem::Parse(const string& s, size_t* pos) {
+  int b, len;
+  if (!ReadInt(s, pos, &b) || !ReadInt(s, pos, &target) || !ReadInt(s, pos, &len))
+    return false;
+  bound = b;
+  if ((len < 0)
+      || (static_cast<size_t>(len) > (s.size() - *pos) / sizeof(value_t)))
+    return false;
+  input.resize(len);
+  if (len > 0)
+    memcpy(&input.front(), s.data() + *pos, len * sizeof(value_t));
+  *pos += len * sizeof(value_t);
+  return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//// CoordinatorSearch /////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////
+
+CoordinatorSearch::CoordinatorSearch(const string& program,
+                                     int max_iterations, int port)
+  : Search(program, max_iterations), port_(port) { }
+
+CoordinatorSearch::~CoordinatorSearch() {
+  for (size_t i = 0; i < workers_.size(); i++) {
+    close(workers_[i].fd);
+  }
+}
+
+
+void CoordinatorSearch::Run() {
+  int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port_);
+  if ((listen_fd < 0)
+      || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr))
+      || listen(listen_fd, 64)) {
+    perror("Failed to listen for workers");
+    exit(-1);
+  }
+  fprintf(stderr, "Coordinator listening on port %d.\n", port_);
+
+  // Hand out the seed inputs (if any) first.
+  while (num_seed_inputs() > 0) {
+    WorkItem item;
+    item.input = NextStartingInput();
+    item.bound = 0;
+    item.target = -1;
+    frontier_.push_back(item);
+  }
+
+  bool had_workers = false;
+  bool done = false;
+  while (!done && !(had_workers && workers_.empty()) && !BudgetExhausted()) {
+    vector<struct pollfd> fds(1 + workers_.size());
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    for (size_t w = 0; w < workers_.size(); w++) {
+      fds[w+1].fd = workers_[w].fd;
+      fds[w+1].events = POLLIN;
+    }
+    // (Wake up every second to check the time budget.)
+    if (poll(&fds.front(), fds.size(), 1000) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("Error waiting for workers");
+      exit(-1);
+    }
+
+    // Messages from the workers.  (Dropped connections are cleaned up
+    // afterwards, so that 'fds' and 'workers_' stay aligned.)
+    for (size_t w = 0; (w < fds.size() - 1) && !done; w++) {
+      if (!(fds[w+1].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      char type;
+      string payload;
+      if (!ReceiveMessage(workers_[w].fd, &type, &payload)) {
+        fprintf(stderr, "Worker %zu disconnected.\n", w);
+        close(workers_[w].fd);
+        workers_[w].fd = -1;
+        continue;
+      }
+      done = !HandleMessage(w, type, payload);
+    }
+    for (size_t w = workers_.size(); w > 0; w--) {
+      if (workers_[w-1].fd < 0)
+        workers_.erase(workers_.begin() + (w-1));
+    }
+
+    // New workers.
+    if (!done && (fds[0].revents & POLLIN)) {
+      Worker wk;
+      wk.fd = accept(listen_fd, NULL, NULL);
+      if (wk.fd >= 0) {
+        setsockopt(wk.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        wk.waiting = false;
+        wk.asked_to_donate = false;
+        workers_.push_back(wk);
+        had_workers = true;
+        fprintf(stderr, "Worker %zu connected.\n", workers_.size() - 1);
+      }
+    }
+    ServeWaitingWorkers();
+  }
+
+  // Out of iterations (or workers).
+  Broadcast('Q', "", workers_.size());
+  close(listen_fd);
+}
+
+
+bool CoordinatorSearch::HandleMessage(size_t w, char type, const string& payload) {
+  if (type == 'R') {
+    workers_[w].waiting = true;
+
+  } else if (type == 'F') {
+    workers_[w].asked_to_donate = false;
+    vector<WorkItem> items;
+    if (ParseItems(payload, &items)) {
+      for (size_t i = 0; i < items.size(); i++) {
+        if (frontier_.size() >= kMaxFrontierSize)
+          break;
+        if ((items[i].target < 0) || !covered_[items[i].target])
+          frontier_.push_back(items[i]);
+      }
+    }
+
+  } else if (type == 'C') {
+    size_t pos = 0;
+    int iters = 0;
+    ReadInt(payload, &pos, &iters);
+    vector<branch_id_t> branches;
+    branch_id_t b;
+    while (ReadInt(payload, &pos, &b)) {
+      branches.push_back(b);
+    }
+
+    set<branch_id_t> new_branches;
+    if (!branches.empty())
+      AddCoverage(branches, &new_branches);
+    if (!new_branches.empty()) {
+      string update;
+      for (set<branch_id_t>::const_iterator i = new_branches.begin();
+           i != new_branches.end(); ++i) {
+        AppendInt(*i, &update);
+      }
+      Broadcast('G', update, w);
+    }
+    return CountIterations(iters);
+  }
+
+  return true;
+}
+
+
+bool CoordinatorSearch::SendWork(size_t w) {
+  // Skip items whose target has been covered in the meantime.
+  while (!frontier_.empty()
+         && (frontier_.front().target >= 0)
+         && covered_[frontier_.front().target]) {
+    frontier_.pop_front();
+  }
+  if (frontier_.empty())
+    return false;
+
+  size_t n = min(kItemsPerRequest, frontier_.size());
+  string payload;
+  SerializeItems(frontier_, 0, n, &payload);
+  frontier_.erase(frontier_.begin(), frontier_.begin() + n);
+  SendMessage(workers_[w].fd, 'W', payload);
+  workers_[w].waiting = false;
+  return true;
+}
+
+
+void CoordinatorSearch::ServeWaitingWorkers() {
+  bool any_waiting = false;
+  bool any_busy = false;
+  for (size_t w = 0; w < workers_.size(); w++) {
+    if (workers_[w].waiting && !SendWork(w))
+      any_waiting = true;
+    if (!workers_[w].waiting)
+      any_busy = true;
+  }
+  if (!any_waiting)
+    return;
+
+  if (any_busy) {
+    // Steal work from the busy workers.
+    for (size_t w = 0; w < workers_.size(); w++) {
+      if (!workers_[w].waiting && !workers_[w].asked_to_donate) {
+        SendMessage(workers_[w].fd, 'D', "");
+        workers_[w].asked_to_donate = true;
+      }
+    }
+  } else {
+    // No one has any work left, so restart everyone from random inputs.
+    deque<WorkItem> seed(1);
+    seed[0].bound = 0;
+    seed[0].target = -1;
+    string payload;
+    SerializeItems(seed, 0, 1, &payload);
+    for (size_t w = 0; w < workers_.size(); w++) {
+      SendMessage(workers_[w].fd, 'W', payload);
+      workers_[w].waiting = false;
+    }
+  }
+}
+
+
+void CoordinatorSearch::Broadcast(char type, const string& payload,
+                                  size_t except) {
+  for (size_t w = 0; w < workers_.size(); w++) {
+    if (w != except)
+      SendMessage(workers_[w].fd, type, payload);
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//// DistributedWorkerSearch ///////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////
+
+DistributedWorkerSearch::DistributedWorkerSearch(const string& program,
+                                                 int max_iterations,
+                                                 const string& host,
+                                                 int port)
+  : Search(program, max_iterations), host_(host), port_(port),
+    fd_(-1), done_(false) { }
+
+DistributedWorkerSearch::~DistributedWorkerSearch() {
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+
+void DistributedWorkerSearch::Run() {
+  { // Connect to the coordinator.
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    char port[16];
+    snprintf(port, sizeof(port), "%d", port_);
+    if (getaddrinfo(host_.c_str(), port, &hints, &res)) {
+      fprintf(stderr, "Unknown coordinator host: %s\n", host_.c_str());
+      exit(-1);
+    }
+    fd_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if ((fd_ < 0) || connect(fd_, res->ai_addr, res->ai_addrlen)) {
+      perror("Failed to connect to coordinator");
+      exit(-1);
+    }
+    freeaddrinfo(res);
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+
+  char type;
+  string payload;
+  while (!done_) {
+    PollMessages();
+    if (done_)
+      break;
+
+    if (queue_.empty()) {
+      // Wait for work (or to be told to quit).
+      SendMessage(fd_, 'R', "");
+      while (!done_ && queue_.empty()) {
+        if (!ReceiveMessage(fd_, &type, &payload)) {
+          done_ = true;
+          break;
+        }
+        HandleMessage(type, payload);
+      }
+      continue;
+    }
+
+    // Our own most recent work first.
+    WorkItem item = queue_.back();
+    queue_.pop_back();
+    if ((item.target >= 0) && covered_[item.target])
+      continue;
+    RunItem(item);
+  }
+}
+
+
+void DistributedWorkerSearch::RunItem(const WorkItem& item) {
+  SymbolicExecution ex;
+  if (!RunProgram(item.input, &ex)) {
+    done_ = true;
+    return;
+  }
+
+  // Report the iteration and any new coverage.
+  set<branch_id_t> new_branches;
+  UpdateCoverage(ex, &new_branches);
+  string report;
+  AppendInt(1, &report);
+  for (set<branch_id_t>::const_iterator i = new_branches.begin();
+       i != new_branches.end(); ++i) {
+    AppendInt(*i, &report);
+  }
+  if (!SendMessage(fd_, 'C', report)) {
+    done_ = true;
+    return;
+  }
+
+  // Solve for the children which could reach uncovered branches.
+  const SymbolicPath& path = ex.path();
+  vector<size_t> idxs;
+  vector<branch_id_t> targets;
+  for (size_t j = item.bound; j < path.constraints().size(); j++) {
+    branch_id_t target = paired_branch_[path.branches()[path.constraints_idx()[j]]];
+    if (!covered_[target]) {
+      idxs.push_back(j);
+      targets.push_back(target);
+    }
+  }
+  vector<solve_result_t> solved;
+  vector< vector<value_t> > inputs;
+  SolveAtBranches(ex, idxs, &solved, &inputs);
+
+  for (size_t k = 0; k < idxs.size(); k++) {
+    if (solved[k] != results::SAT)
+      continue;
+    MarkInFlight(ex, idxs[k]);
+    WorkItem child;
+    child.input.swap(inputs[k]);
+    child.bound = idxs[k] + 1;
+    child.target = targets[k];
+    queue_.push_back(child);
+  }
+}
+
+
+void DistributedWorkerSearch::HandleMessage(char type, const string& payload) {
+  if (type == 'W') {
+    vector<WorkItem> items;
+    if (ParseItems(payload, &items))
+      queue_.insert(queue_.end(), items.begin(), items.end());
+
+  } else if (type == 'G') {
+    vector<branch_id_t> branches;
+    size_t pos = 0;
+    branch_id_t b;
+    while (ReadInt(payload, &pos, &b)) {
+      branches.push_back(b);
+    }
+    AddCoverage(branches, NULL);
+
+  } else if (type == 'D') {
+    // Donate the older half of our queue -- the items closest to the
+    // start of their paths, which likely lead to the most work.
+    size_t n = queue_.size() / 2;
+    string items;
+    SerializeItems(queue_, 0, n, &items);
+    queue_.erase(queue_.begin(), queue_.begin() + n);
+    SendMessage(fd_, 'F', items);
+
+  } else if (type == 'Q') {
+    done_ = true;
+  }
+}
+
+
+void DistributedWorkerSearch::PollMessages() {
+  struct pollfd pfd;
+  pfd.fd = fd_;
+  pfd.events = POLLIN;
+  char type;
+  string payload;
+  while ((poll(&pfd, 1, 0) > 0) && (pfd.revents & (POLLIN | POLLHUP))) {
+    if (!ReceiveMessage(fd_, &type, &payload)) {
+      done_ = true;
+      return;
+    }
+    HandleMessage(type, payload);
+  }
+}
+
+}  // namespace crest
@@ -0,0 +1,106 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef RUN_CREST_DISTRIBUTED_SEARCH_H__
+#define RUN_CREST_DISTRIBUTED_SEARCH_H__
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "base/basic_types.h"
+#include "run_crest/concolic_search.h"
+
+using std::deque;
+using std::string;
+using std::vector;
+
+namespace crest {
+
+//
+// A search spread across machines: one coordinator and any number of
+// workers, talking over TCP.
+//
+// A work item is an input to run, together with the index of the first
+// constraint of its path that may be negated.  A worker runs an item,
+// reports the iteration and any newly covered branches to the
+// coordinator, and then solves for the negation of each later
+// constraint leading to an uncovered branch -- each solution becoming a
+// new item on the worker's own queue.
+//
+// Workers pull items from the coordinator only once their own queues
+// are empty.  If the coordinator then has nothing to hand out, it asks
+// a busy worker to donate the older half of its queue (i.e. work is
+// stolen from the busy workers).  The coordinator holds the global
+// coverage, and broadcasts newly covered branches to all workers, so
+// that no one keeps working towards an already covered branch.
+//
+struct WorkItem {
+  vector<value_t> input;
+  size_t bound;
+  branch_id_t target;  // The branch this input should cover (or -1).
+
+  void Serialize(string* s) const;
+  bool Parse(const string& s, size_t* pos);
+};
+
+
+class CoordinatorSearch : public Search {
+ public:
+  CoordinatorSearch(const string& program, int max_iterations, int port);
+  virtual ~CoordinatorSearch();
+
+  virtual void Run();
+
+ private:
+  struct Worker {
+    int fd;
+    bool waiting;        // For work.
+    bool asked_to_donate;
+  };
+
+  const int port_;
+  vector<Worker> workers_;
+  deque<WorkItem> frontier_;
+
+  static const size_t kMaxFrontierSize = 100000;
+  static const size_t kItemsPerRequest = 4;
+
+  bool HandleMessage(size_t w, char type, const string& payload);
+  void ServeWaitingWorkers();
+  bool SendWork(size_t w);
+  void Broadcast(char type, const string& payload, size_t except);
+};
+
+
+class DistributedWorkerSearch : public Search {
+ public:
+  DistributedWorkerSearch(const string& program, int max_iterations,
+                          const string& host, int port);
+  virtual ~DistributedWorkerSearch();
+
+  virtual void Run();
+
+ private:
+  const string host_;
+  const int port_;
+  int fd_;
+  bool done_;
+
+  deque<WorkItem> queue_;
+
+  void RunItem(const WorkItem& item);
+  void HandleMessage(char type, const string& payload);
+  void PollMessages();
+};
+
+}  // namespace crest
+
+#endif  // RUN_CREST_DISTRIBUTED_SEARCH_H__
@@ -0,0 +1,306 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <algorithm>
+#include <assert.h>
+#include <utility>
+
+#include "run_crest/execution_tree.h"
+
+using std::make_pair;
+using std::max;
+using std::pair;
+
+namespace crest {
+
+ExecutionTree::ExecutionTree(const vector<branch_id_t>& paired_branch)
+  : paired_branch_(paired_branch), root_(NULL),
+    num_nodes_(0), num_labels_(0), max_memory_(0) {
+  vector<branch_id_t> empty;
+  root_ = NewNode(NULL, empty, 0, EXPLORED);
+}
+
+
+ExecutionTree::~ExecutionTree() {
+  FreeSubtree(root_);
+}
+
+
+size_t ExecutionTree::memory() const {
+  return (num_nodes_ * (sizeof(Node) + sizeof(Node*))
+          + num_labels_ * sizeof(branch_id_t));
+}
+
+
+ExecutionTree::Node* ExecutionTree::NewNode(Node* parent,
+                                            const vector<branch_id_t>& key,
+                                            size_t begin, State state) {
+  Node* node = new Node;
+  node->parent = parent;
+  node->label.assign(key.begin() + begin, key.end());
+  node->state = state;
+  node->ended = false;
+  node->closed = false;
+  if (parent)
+    parent->children.push_back(node);
+  num_nodes_++;
+  num_labels_ += node->label.size();
+  return node;
+}
+
+
+void ExecutionTree::FreeSubtree(Node* node) {
+  // (Iteratively, as the tree can be very deep.)
+  vector<Node*> stack(1, node);
+  while (!stack.empty()) {
+    Node* n = stack.back();
+    stack.pop_back();
+    stack.insert(stack.end(), n->children.begin(), n->children.end());
+    num_nodes_--;
+    num_labels_ -= n->label.size();
+    delete n;
+  }
+}
+
+
+void ExecutionTree::FreeChildren(Node* node) {
+  for (size_t i = 0; i < node->children.size(); i++) {
+    FreeSubtree(node->children[i]);
+  }
+  vector<Node*>().swap(node->children);
+}
+
+
+ExecutionTree::Node* ExecutionTree::Child(const Node* node,
+                                          branch_id_t b) const {
+  for (size_t i = 0; i < node->children.size(); i++) {
+    if (node->children[i]->label[0] == b)
+      return node->children[i];
+  }
+  return NULL;
+}
+
+
+void ExecutionTree::Key(const SymbolicPath& path, size_t len, bool negate,
+                        vector<branch_id_t>* key) const {
+  key->resize(len);
+  for (size_t k = 0; k < len; k++) {
+    (*key)[k] = path.branches()[path.constraints_idx()[k]];
+  }
+  if (negate && (len > 0))
+    key->back() = paired_branch_[key->back()];
+}
+
+
+void ExecutionTree::Insert(const SymbolicPath& path) {
+  vector<branch_id_t> key;
+  Key(path, path.constraints().size(), false, &key);
+
+  vector<Node*> visited;
+  Node* end = Extend(key, EXPLORED, &visited);
+  if (!end)
+    return;
+  for (size_t i = 0; i < visited.size(); i++) {
+    visited[i]->state = EXPLORED;
+  }
+  end->ended = true;
+  UpdateClosed(visited);
+  Compact();
+}
+
+
+ExecutionTree::State ExecutionTree::Lookup(const SymbolicPath& path,
+                                           size_t i) const {
+  vector<branch_id_t> key;
+  Key(path, i + 1, true, &key);
+
+  if (root_->closed)
+    return CLOSED;
+  const Node* node = root_;
+  size_t pos = 0;
+  while (pos < key.size()) {
+    const Node* child = Child(node, key[pos]);
+    if (!child)
+      return UNKNOWN;
+    if (child->closed)
+      return (child->state == EXPLORED) ? CLOSED : State(child->state);
+    size_t m = 1;
+    while ((m < child->label.size()) && (pos + m < key.size())
+           && (child->label[m] == key[pos + m])) {
+      m++;
+    }
+    pos += m;
+    if (m < child->label.size()) {
+      // Inside the label, everything is explored.
+      return (pos == key.size()) ? EXPLORED : UNKNOWN;
+    }
+    node = child;
+  }
+  return State(node->state);
+}
+
+
+void ExecutionTree::Mark(const SymbolicPath& path, size_t i, State state) {
+  assert((state != UNKNOWN) && (state != CLOSED));
+  vector<branch_id_t> key;
+  Key(path, i + 1, true, &key);
+
+  vector<Node*> visited;
+  Node* end = Extend(key, state, &visited);
+  if (end && (end->state != EXPLORED)) {
+    end->state = state;
+    UpdateClosed(visited);
+  }
+  Compact();
+}
+
+
+ExecutionTree::Node* ExecutionTree::Extend(const vector<branch_id_t>& key,
+                                           State state,
+                                           vector<Node*>* visited) {
+  Node* node = root_;
+  visited->push_back(node);
+  if (node->closed)
+    return NULL;
+
+  size_t pos = 0;
+  while (pos < key.size()) {
+    Node* child = Child(node, key[pos]);
+    if (!child) {
+      child = NewNode(node, key, pos, state);
+      visited->push_back(child);
+      return child;
+    }
+    if (child->closed)
+      return NULL;
+
+    size_t m = 1;
+    while ((m < child->label.size()) && (pos + m < key.size())
+           && (child->label[m] == key[pos + m])) {
+      m++;
+    }
+    if (m < child->label.size()) {
+      // Split the child's label after the common part.  (The new node
+      // ends inside the old label, so it is explored.)
+      Node* split = new Node;
+      split->parent = node;
+      split->label.assign(child->label.begin(), child->label.begin() + m);
+      split->state = EXPLORED;
+      split->ended = false;
+      split->closed = false;
+      split->children.push_back(child);
+      *find(node->children.begin(), node->children.end(), child) = split;
+      child->parent = split;
+      child->label.erase(child->label.begin(), child->label.begin() + m);
+      num_nodes_++;
+      child = split;
+    }
+    visited->push_back(child);
+    node = child;
+    pos += m;
+  }
+  return node;
+}
+
+
+bool ExecutionTree::IsClosed(const Node* node) const {
+  // Alternatives to the branches inside the label are unknown.
+  if (node->label.size() > 1)
+    return false;
+  if (node->state == UNSAT)
+    return true;
+  if (node->state != EXPLORED)
+    return false;
+  if (!node->ended && node->children.empty())
+    return false;
+  for (size_t i = 0; i < node->children.size(); i++) {
+    const Node* child = node->children[i];
+    if (!child->closed
+        || !Child(node, paired_branch_[child->label[0]]))
+      return false;
+  }
+  return true;
+}
+
+
+void ExecutionTree::UpdateClosed(const vector<Node*>& visited) {
+  for (size_t i = visited.size(); i-- > 0; ) {
+    Node* node = visited[i];
+    if (node->closed || !IsClosed(node))
+      continue;
+    node->closed = true;
+    FreeChildren(node);
+  }
+}
+
+
+void ExecutionTree::Truncate(size_t depth) {
+  // (Each node with the depth at which its label starts.)
+  vector< pair<Node*,size_t> > stack;
+  stack.push_back(make_pair(root_, 0));
+  while (!stack.empty()) {
+    Node* node = stack.back().first;
+    size_t start = stack.back().second + node->label.size();
+    stack.pop_back();
+
+    vector<Node*> kept;
+    for (size_t i = 0; i < node->children.size(); i++) {
+      Node* child = node->children[i];
+      if (start >= depth) {
+        FreeSubtree(child);
+        continue;
+      }
+      if (start + child->label.size() > depth) {
+        num_labels_ -= child->label.size() - (depth - start);
+        child->label.resize(depth - start);
+        FreeChildren(child);
+        child->state = EXPLORED;
+        child->ended = false;
+      } else {
+        stack.push_back(make_pair(child, start));
+      }
+      kept.push_back(child);
+    }
+    if (kept.size() < node->children.size()) {
+      // (No longer known to end here, with no other way onward.)
+      node->children.swap(kept);
+      node->ended = false;
+    }
+  }
+}
+
+
+void ExecutionTree::Compact() {
+  if ((max_memory_ == 0) || (memory() <= max_memory_))
+    return;
+
+  // Forget everything below half the depth of the tree, and then half
+  // that, and so on, until the tree is down to half its limit.
+  size_t max_depth = 0;
+  vector< pair<Node*,size_t> > stack;
+  stack.push_back(make_pair(root_, 0));
+  while (!stack.empty()) {
+    Node* node = stack.back().first;
+    size_t end = stack.back().second + node->label.size();
+    stack.pop_back();
+    max_depth = max(max_depth, end);
+    for (size_t i = 0; i < node->children.size(); i++) {
+      stack.push_back(make_pair(node->children[i], end));
+    }
+  }
+
+  size_t depth = max_depth;
+  do {
+    depth /= 2;
+    Truncate(depth);
+  } while ((depth > 0) && (memory() > max_memory_ / 2));
+}
+
+}  // namespace crest
@@ -0,0 +1,115 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef RUN_CREST_EXECUTION_TREE_H__
+#define RUN_CREST_EXECUTION_TREE_H__
+
+#include <vector>
+
+#include "base/basic_types.h"
+#include "base/symbolic_path.h"
+
+using std::vector;
+
+namespace crest {
+
+//
+// The tree of all paths explored so far, as a trie over the symbolic
+// branches of each path (the branches at which the path has a
+// constraint).  Each prefix is either explored (some execution followed
+// it) or a negation which was tried without reaching it: one which is
+// in flight (solved, but not yet run), unsat, timed out, or divergent
+// (solved, but the program took a different path).
+//
+// Runs of explored prefixes with no alternatives recorded are stored
+// together in one node.  A node is closed once everything below it has
+// been explored or found unsat, and its subtree is then freed.  If the
+// tree still grows past its memory limit, everything below some depth
+// is forgotten -- which only means that some work may be repeated.
+//
+class ExecutionTree {
+ public:
+  enum State {
+    UNKNOWN = 0,  // (Not in the tree.)
+    EXPLORED,
+    IN_FLIGHT,
+    UNSAT,
+    TIMED_OUT,
+    DIVERGENT,
+    CLOSED        // (Explored, along with everything below it.)
+  };
+
+  // Pairs of branches are given by 'paired_branch'.
+  explicit ExecutionTree(const vector<branch_id_t>& paired_branch);
+  ~ExecutionTree();
+
+  // Limits the tree to (about) 'bytes' of memory.
+  void set_max_memory(size_t bytes) { max_memory_ = bytes; }
+
+  // Adds the (symbolic) path of 'path' as explored.
+  void Insert(const SymbolicPath& path);
+
+  // The state of the negation of constraint 'i' of 'path'.
+  State Lookup(const SymbolicPath& path, size_t i) const;
+
+  // Records the state of the negation of constraint 'i' of 'path'.
+  // (Explored prefixes stay explored.)
+  void Mark(const SymbolicPath& path, size_t i, State state);
+
+  // Has everything been explored (or found unsat)?
+  bool closed() const { return root_->closed; }
+
+  size_t num_nodes() const { return num_nodes_; }
+  size_t memory() const;
+
+ private:
+  struct Node {
+    Node* parent;
+    vector<branch_id_t> label;  // The branches from the parent to here.
+    vector<Node*> children;
+    unsigned char state;        // (Every prefix inside the label is explored.)
+    bool ended;                 // Did an execution end here?
+    bool closed;
+  };
+
+  const vector<branch_id_t>& paired_branch_;
+  Node* root_;
+  size_t num_nodes_;
+  size_t num_labels_;  // Total length of the labels.
+  size_t max_memory_;
+
+  Node* NewNode(Node* parent, const vector<branch_id_t>& key,
+                size_t begin, State state);
+  void FreeSubtree(Node* node);
+  void FreeChildren(Node* node);
+  Node* Child(const Node* node, branch_id_t b) const;
+
+  // The first 'len' symbolic branches of 'path' -- with the last one
+  // negated, if 'negate'.
+  void Key(const SymbolicPath& path, size_t len, bool negate,
+           vector<branch_id_t>* key) const;
+
+  // Adds 'key' to the tree (with any new prefixes in 'state'), so that
+  // it ends at a node, which is returned -- or NULL, if 'key' runs into
+  // a closed node.  The nodes along 'key' are appended to 'visited'.
+  Node* Extend(const vector<branch_id_t>& key, State state,
+               vector<Node*>* visited);
+
+  bool IsClosed(const Node* node) const;
+  void UpdateClosed(const vector<Node*>& visited);
+
+  // Forgets prefixes longer than 'depth'.
+  void Truncate(size_t depth);
+  void Compact();
+};
+
+}  // namespace crest
+
+#endif  // RUN_CREST_EXECUTION_TREE_H__
@@ -0,0 +1,174 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <sys/time.h>
+
+#include "run_crest/portfolio_search.h"
+
+using std::max;
+using std::min;
+
+namespace crest {
+
+namespace {
+
+// The iterations in each slice, and the factor by which the history of
+// every strategy is discounted after each slice.
+const int kSliceIterations = 50;
+const double kDiscount = 0.9;
+
+// (Slices faster than this are timed as this.)
+const double kMinSliceTime = 0.01;
+
+double WallTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+Solver::Stats StatsSince(const Solver::Stats& now,
+                         const Solver::Stats& before) {
+  Solver::Stats s;
+  s.num_queries = now.num_queries - before.num_queries;
+  s.num_sat = now.num_sat - before.num_sat;
+  s.num_unsat = now.num_unsat - before.num_unsat;
+  s.num_unknown = now.num_unknown - before.num_unknown;
+  s.solve_time = now.solve_time - before.solve_time;
+  return s;
+}
+
+}  // namespace
+
+
+PortfolioSearch::PortfolioSearch(const string& program, int max_iterations)
+  : Search(program, max_iterations), max_reward_(0) { }
+
+
+PortfolioSearch::~PortfolioSearch() {
+  for (size_t i = 0; i < arms_.size(); i++) {
+    delete arms_[i].search;
+  }
+}
+
+
+void PortfolioSearch::AddStrategy(const string& name, Search* strategy) {
+  Arm arm;
+  arm.name = name;
+  arm.search = strategy;
+  arm.done = false;
+  arm.plays = 0;
+  arm.rewards = 0;
+  arm.num_slices = 0;
+  arm.num_new_branches = 0;
+  arm.time = 0;
+  arm.program_time = 0;
+  arms_.push_back(arm);
+}
+
+
+void PortfolioSearch::Run() {
+  size_t last = arms_.size();
+  while (!BudgetExhausted()) {
+    MaybeCheckpoint();
+    size_t k = ChooseArm();
+    if (k == arms_.size())
+      break;
+    if (k != last)
+      fprintf(stderr, "Portfolio: running %s.\n", arms_[k].name.c_str());
+    last = k;
+    RunArm(k);
+  }
+  PrintStats();
+}
+
+
+size_t PortfolioSearch::ChooseArm() const {
+  double total_plays = 0;
+  for (size_t i = 0; i < arms_.size(); i++) {
+    if (!arms_[i].done)
+      total_plays += arms_[i].plays;
+  }
+
+  size_t best = arms_.size();
+  double best_score = 0;
+  for (size_t i = 0; i < arms_.size(); i++) {
+    const Arm& arm = arms_[i];
+    if (arm.done)
+      continue;
+    if (arm.num_slices == 0) {
+      // Run each strategy once before comparing them.
+      return i;
+    }
+    double mean = (max_reward_ > 0) ? arm.rewards / arm.plays / max_reward_ : 0;
+    double score =
+      mean + sqrt(2 * log(max(total_plays, 1.0)) / arm.plays);
+    if ((best == arms_.size()) || (score > best_score)) {
+      best = i;
+      best_score = score;
+    }
+  }
+  return best;
+}
+
+
+void PortfolioSearch::RunArm(size_t k) {
+  Arm& arm = arms_[k];
+
+  // Run a slice, starting from everything covered so far.
+  arm.search->ImportCoverage(*this);
+  const int start_iters = arm.search->num_iterations();
+  const double start = WallTime();
+  arm.done = !arm.search->RunSlice(min(kSliceIterations, iterations_left()));
+  const double elapsed = WallTime() - start;
+  const int iters = arm.search->num_iterations() - start_iters;
+  if (iters == 0) {
+    // (Making no progress.)
+    arm.done = true;
+  }
+
+  // Count the slice towards the portfolio.
+  CountIterations(iters);
+  const Solver::Stats stats = arm.search->solver_stats();
+  CountWorkTime(arm.search->program_time() - arm.program_time,
+                StatsSince(stats, arm.solver_stats));
+  arm.program_time = arm.search->program_time();
+  arm.solver_stats = stats;
+  const size_t found = ImportCoverage(*arm.search);
+
+  // Discount the history of every strategy, and reward this one.
+  const double reward = found / max(elapsed, kMinSliceTime);
+  max_reward_ = max(max_reward_, reward);
+  for (size_t i = 0; i < arms_.size(); i++) {
+    arms_[i].plays *= kDiscount;
+    arms_[i].rewards *= kDiscount;
+  }
+  arm.plays += 1;
+  arm.rewards += reward;
+
+  arm.num_slices++;
+  arm.num_new_branches += found;
+  arm.time += elapsed;
+}
+
+
+void PortfolioSearch::PrintStats() const {
+  for (size_t i = 0; i < arms_.size(); i++) {
+    const Arm& arm = arms_[i];
+    fprintf(stderr, "Portfolio: %s ran %u slices (%d iterations, %.1fs), "
+            "covering %u new branches%s.\n",
+            arm.name.c_str(), arm.num_slices, arm.search->num_iterations(),
+            arm.time, arm.num_new_branches, arm.done ? " (finished)" : "");
+  }
+}
+
+}  // namespace crest
@@ -0,0 +1,86 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef RUN_CREST_PORTFOLIO_SEARCH_H__
+#define RUN_CREST_PORTFOLIO_SEARCH_H__
+
+#include <string>
+#include <vector>
+
+#include "base/basic_types.h"
+#include "run_crest/concolic_search.h"
+
+using std::string;
+using std::vector;
+
+namespace crest {
+
+//
+// A portfolio of strategies, run by turns over a shared coverage.
+//
+// Each turn runs one strategy for a slice of iterations (see
+// Search::RunSlice), after handing it everything covered so far; the
+// branches it covers first then count towards the portfolio.  Which
+// strategy runs next is picked by a multi-armed bandit (discounted
+// UCB1), rewarding each strategy by the new branches it covers per
+// second -- so that the portfolio moves on from strategies whose yield
+// has dropped, while still trying the others now and then.
+//
+// Between its turns, a strategy keeps what state Search::RunSlice says
+// it does.  A strategy leaves the portfolio once it finishes (or runs
+// out of a budget of its own).  A resumed portfolio keeps its coverage,
+// but starts its strategies over.
+//
+class PortfolioSearch : public Search {
+ public:
+  PortfolioSearch(const string& program, int max_iterations);
+  virtual ~PortfolioSearch();
+
+  // Adds 'strategy' (taking ownership of it), reported as 'name'.
+  void AddStrategy(const string& name, Search* strategy);
+
+  virtual void Run();
+
+ private:
+  struct Arm {
+    string name;
+    Search* search;
+    bool done;
+
+    // Discounted number of slices, and sum of their rewards.
+    double plays;
+    double rewards;
+
+    // Totals, for the report.
+    unsigned int num_slices;
+    unsigned int num_new_branches;
+    double time;
+
+    // The program time and solver use of the strategy so far.
+    double program_time;
+    Solver::Stats solver_stats;
+  };
+  vector<Arm> arms_;
+
+  // The largest reward seen, by which rewards are scaled to [0, 1].
+  double max_reward_;
+
+  // Returns the next arm to run, or arms_.size() once all are done.
+  size_t ChooseArm() const;
+
+  // Runs arm 'k' for one slice, and updates its rewards.
+  void RunArm(size_t k);
+
+  void PrintStats() const;
+};
+
+}  // namespace crest
+
+#endif  // RUN_CREST_PORTFOLIO_SEARCH_H__
@@ -9,26 +9,145 @@
 // for details.
 
 #include <assert.h>
+#include <fstream>
+#include <map>
 #include <stdio.h>
+#include <string>
 #include <sys/time.h>
+#include <vector>
 
 #include "run_crest/concolic_search.h"
+#include "run_crest/distributed_search.h"
+#include "run_crest/portfolio_search.h"
+
+using std::ifstream;
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The strategies run by "-portfolio", unless others are listed.
+const char kDefaultPortfolio[] = "dfs,cfg,generational,random,uniform_random";
+
+// Returns a new search with strategy 'type' (e.g. "dfs"), given the
+// strategy option 'arg' (or "", for the default) -- or NULL if there is
+// no such strategy.
+crest::Search* NewStrategy(const string& type, const string& arg,
+                           const string& prog, int num_iters) {
+  if (type == "random") {
+    return new crest::RandomSearch(prog, num_iters);
+  } else if (type == "random_input") {
+    return new crest::RandomInputSearch(prog, num_iters);
+  } else if (type == "dfs") {
+    return new crest::BoundedDepthFirstSearch(
+        prog, num_iters, arg.empty() ? 1000000 : atoi(arg.c_str()));
+  } else if (type == "cfg") {
+    return new crest::CfgHeuristicSearch(prog, num_iters);
+  } else if (type == "cfg_baseline") {
+    return new crest::CfgBaselineSearch(prog, num_iters);
+  } else if (type == "generational") {
+    return new crest::GenerationalSearch(prog, num_iters);
+  } else if (type == "hybrid") {
+    return new crest::HybridSearch(prog, num_iters, 100);
+  } else if (type == "uniform_random") {
+    return new crest::UniformRandomSearch(
+        prog, num_iters, arg.empty() ? 100000000 : atoi(arg.c_str()));
+  }
+  return NULL;
+}
+
+// Reads the branch ids in 'arg' -- either a file of ids (separated by
+// whitespace), or a comma-separated list -- into 'ids'.  Returns false
+// if 'arg' holds anything but ids.
+bool ReadTargets(const string& arg, vector<crest::branch_id_t>* ids) {
+  ifstream in(arg.c_str());
+  if (in) {
+    crest::branch_id_t id;
+    while (in >> id) {
+      ids->push_back(id);
+    }
+    return in.eof();
+  }
+
+  for (size_t pos = 0; pos <= arg.size(); ) {
+    size_t comma = arg.find(',', pos);
+    if (comma == string::npos)
+      comma = arg.size();
+    string id = arg.substr(pos, comma - pos);
+    char* end;
+    ids->push_back(strtol(id.c_str(), &end, 10));
+    if (id.empty() || *end)
+      return false;
+    pos = comma + 1;
+  }
+  return true;
+}
+
+}  // namespace
 
 int main(int argc, char* argv[]) {
-  if (argc < 4) {
+  // Separate the "--name=value" options from the positional arguments.
+  map<string,string> options;
+  vector<string> args;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg.compare(0, 2, "--") == 0) {
+      size_t eq = arg.find('=');
+      if (eq == string::npos) {
+        options[arg.substr(2)] = "";
+      } else {
+        options[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+      }
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  // A distributed search needs no strategy.
+  bool distributed = (options.count("coordinator") || options.count("worker"));
+
+  if ((args.size() < 3) && !(distributed && (args.size() == 2))) {
     fprintf(stderr,
             "Syntax: run_crest <program> "
             "<number of iterations> "
-            "-<strategy> [strategy options]\n");
+            "-<strategy> [strategy options] [--option=value ...]\n");
     fprintf(stderr,
             "  Strategies include: "
-            "dfs, cfg, random, uniform_random, random_input \n");
+            "dfs, cfg, random, uniform_random, random_input, generational,\n"
+            "  portfolio [STRATEGY,...] (default: %s),\n"
+            "  and directed TARGETS (a file of branch ids, or ID,...)\n",
+            kDefaultPortfolio);
+    fprintf(stderr,
+            "  Options include:\n"
+            "    --coordinator=PORT  coordinate a distributed search on PORT\n"
+            "    --worker=HOST:PORT  work for the coordinator at HOST:PORT\n"
+            "    --solver=NAME       solver backend: yices (default), z3\n"
+            "    --dump_queries=DIR  write every solver query to DIR (SMT-LIB)\n"
+            "    --solver_workers=N  solve batches of branches using N processes\n"
+            "    --solver_timeout=S  give up on solver queries after S seconds\n"
+            "    --max_solver_share=F\n"
+            "                        skip solving while it takes over a fraction F\n"
+            "                        of the running time\n"
+            "    --max_time=S        stop after S seconds\n"
+            "    --max_solver_time=S stop after S seconds spent solving\n"
+            "    --max_memory=MB     stop once run_crest uses MB megabytes\n"
+            "    --max_tree_memory=MB\n"
+            "                        limit the execution tree to MB megabytes\n"
+            "    --frontier_memory=MB\n"
+            "                        keep at most MB megabytes of suspended\n"
+            "                        paths, re-running the programs for others\n"
+            "    --corpus=DIR        save inputs which cover new branches to DIR\n"
+            "    --seed=DIR          start from the inputs in corpus DIR\n"
+            "    --seed_jobs=N       run N seed inputs at a time\n"
+            "    --checkpoint=S      save the search state every S seconds\n"
+            "    --resume            resume from the last saved search state\n");
     return 1;
   }
 
-  string prog = argv[1];
-  int num_iters = atoi(argv[2]);
-  string search_type = argv[3];
+  string prog = args[0];
+  int num_iters = atoi(args[1].c_str());
+  string search_type = distributed ? "" : args[2];
 
   // Initialize the random number generator.
   struct timeval tv;
@@ -36,37 +155,146 @@ int main(int argc, char* argv[]) {
   srand((tv.tv_sec * 1000000) + tv.tv_usec);
 
   crest::Search* strategy;
-  if (search_type == "-random") {
-    strategy = new crest::RandomSearch(prog, num_iters);
-  } else if (search_type == "-random_input") {
-    strategy = new crest::RandomInputSearch(prog, num_iters);
-  } else if (search_type == "-dfs") {
-    if (argc == 4) {
-      strategy = new crest::BoundedDepthFirstSearch(prog, num_iters, 1000000);
-    } else {
-      strategy = new crest::BoundedDepthFirstSearch(prog, num_iters, atoi(argv[4]));
+  vector<crest::Search*> searches;
+  if (options.count("coordinator")) {
+    strategy = new crest::CoordinatorSearch(prog, num_iters,
+                                            atoi(options["coordinator"].c_str()));
+    options.erase("coordinator");
+  } else if (options.count("worker")) {
+    string addr = options["worker"];
+    size_t colon = addr.rfind(':');
+    if (colon == string::npos) {
+      fprintf(stderr, "Expected --worker=HOST:PORT\n");
+      return 1;
+    }
+    strategy = new crest::DistributedWorkerSearch(prog, num_iters,
+                                                  addr.substr(0, colon),
+                                                  atoi(addr.c_str() + colon + 1));
+    options.erase("worker");
+  } else if (search_type == "-portfolio") {
+    crest::PortfolioSearch* portfolio =
+      new crest::PortfolioSearch(prog, num_iters);
+    string names = (args.size() > 3) ? args[3] : kDefaultPortfolio;
+    for (size_t pos = 0; pos <= names.size(); ) {
+      size_t comma = names.find(',', pos);
+      if (comma == string::npos)
+        comma = names.size();
+      string name = names.substr(pos, comma - pos);
+      crest::Search* s = NewStrategy(name, "", prog, num_iters);
+      if (!s) {
+        fprintf(stderr, "Unknown search strategy: %s\n", name.c_str());
+        return 1;
+      }
+      portfolio->AddStrategy(name, s);
+      searches.push_back(s);
+      pos = comma + 1;
+    }
+    strategy = portfolio;
+  } else if (search_type == "-directed") {
+    vector<crest::branch_id_t> targets;
+    if ((args.size() < 4) || !ReadTargets(args[3], &targets)
+        || targets.empty()) {
+      fprintf(stderr, "Expected -directed TARGETS (a file of branch ids, "
+              "or ID,...)\n");
+      return 1;
     }
-  } else if (search_type == "-cfg") {
     strategy = new crest::CfgHeuristicSearch(prog, num_iters);
-  } else if (search_type == "-cfg_baseline") {
-    strategy = new crest::CfgBaselineSearch(prog, num_iters);
-  } else if (search_type == "-hybrid") {
-    strategy = new crest::HybridSearch(prog, num_iters, 100);
-  } else if (search_type == "-uniform_random") {
-    if (argc == 4) {
-      strategy = new crest::UniformRandomSearch(prog, num_iters, 100000000);
-    } else {
-      strategy = new crest::UniformRandomSearch(prog, num_iters, atoi(argv[4]));
+    if (!strategy->SetTargets(targets)) {
+      fprintf(stderr, "Not a branch of %s among the targets: %s\n",
+              prog.c_str(), args[3].c_str());
+      return 1;
     }
   } else {
-    fprintf(stderr, "Unknown search strategy: %s\n", search_type.c_str());
+    strategy = NULL;
+    if (search_type.compare(0, 1, "-") == 0) {
+      strategy = NewStrategy(search_type.substr(1),
+                             (args.size() > 3) ? args[3] : "",
+                             prog, num_iters);
+    }
+    if (!strategy) {
+      fprintf(stderr, "Unknown search strategy: %s\n", search_type.c_str());
+      return 1;
+    }
+  }
+  // The searches which run the program and solve (i.e. the strategies
+  // of a portfolio, rather than the portfolio itself).
+  bool portfolio = !searches.empty();
+  if (!portfolio)
+    searches.push_back(strategy);
+
+  bool resume = false;
+  string seed_dir;
+  int seed_jobs = 1;
+  for (map<string,string>::const_iterator i = options.begin();
+       i != options.end(); ++i) {
+    // The options for solving (and for the memory kept while solving)
+    // apply to each search which solves.
+    bool handled = true;
+    for (size_t j = 0; j < searches.size(); j++) {
+      crest::Search* s = searches[j];
+      if (i->first == "solver") {
+        if (!s->SetSolver(i->second)) {
+          fprintf(stderr, "Unknown solver: %s\n", i->second.c_str());
+          return 1;
+        }
+      } else if (i->first == "solver_workers") {
+        s->SetSolverWorkers(atoi(i->second.c_str()));
+      } else if (i->first == "solver_timeout") {
+        s->SetSolverTimeout(atof(i->second.c_str()));
+      } else if (i->first == "max_solver_share") {
+        s->SetMaxSolverShare(atof(i->second.c_str()));
+      } else if (i->first == "max_tree_memory") {
+        s->SetMaxTreeMemory(atoi(i->second.c_str()));
+      } else if (i->first == "frontier_memory") {
+        s->SetFrontierMemory(atoi(i->second.c_str()));
+      } else {
+        handled = false;
+      }
+    }
+    if (handled)
+      continue;
+
+    if (portfolio && ((i->first == "dump_queries") || (i->first == "corpus")
+                      || (i->first == "seed"))) {
+      fprintf(stderr, "--%s is not supported with -portfolio.\n",
+              i->first.c_str());
+      return 1;
+    }
+
+    if (i->first == "dump_queries") {
+      strategy->SetQueryDumpDir(i->second);
+    } else if (i->first == "max_time") {
+      strategy->SetMaxTime(atof(i->second.c_str()));
+    } else if (i->first == "max_solver_time") {
+      strategy->SetMaxSolverTime(atof(i->second.c_str()));
+    } else if (i->first == "max_memory") {
+      strategy->SetMaxMemory(atoi(i->second.c_str()));
+    } else if (i->first == "corpus") {
+      strategy->SetCorpusDir(i->second);
+    } else if (i->first == "checkpoint") {
+      strategy->SetCheckpointInterval(atof(i->second.c_str()));
+    } else if (i->first == "seed") {
+      seed_dir = i->second;
+    } else if (i->first == "seed_jobs") {
+      seed_jobs = atoi(i->second.c_str());
+    } else if (i->first == "resume") {
+      resume = true;
+    } else {
+      fprintf(stderr, "Unknown option: --%s\n", i->first.c_str());
+      return 1;
+    }
+  }
+
+  if (resume && !strategy->Resume()) {
+    fprintf(stderr, "No checkpoint to resume from.\n");
     return 1;
   }
+  if (!seed_dir.empty())
+    strategy->Seed(seed_dir, seed_jobs);
 
   strategy->Run();
+  strategy->Finish();
 
   delete strategy;
   return 0;
 }
-
-
@@ -0,0 +1,540 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <set>
+#include <signal.h>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "run_crest/solver_pool.h"
+
+using std::istringstream;
+using std::max;
+using std::min;
+using std::set;
+
+namespace crest {
+
+namespace {
+
+// The parent's ends of the pipes to every worker, of every pool in this
+// process -- which each new worker closes, so that no worker holds open
+// the pipes of another.
+set<int> parent_fds;
+
+void CloseParentFd(int fd) {
+  close(fd);
+  parent_fds.erase(fd);
+}
+
+double WallTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+void WriteOrDie(int fd, const void* buf, size_t len) {
+  const char* p = static_cast<const char*>(buf);
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("Error writing to solver worker");
+      exit(-1);
+    }
+    p += n;
+    len -= n;
+  }
+}
+
+// Returns false on end-of-file.
+bool ReadFully(int fd, void* buf, size_t len) {
+  char* p = static_cast<char*>(buf);
+  while (len > 0) {
+    ssize_t n = read(fd, p, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (n == 0)
+      return false;
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+// Serializes the part of an execution needed to solve at its branches:
+// the inputs, the variable types, and the path constraints.
+void SerializeQueries(const SymbolicExecution& ex, string* s) {
+  size_t len = ex.inputs().size();
+  s->append((char*)&len, sizeof(len));
+  if (len > 0)
+    s->append((char*)&ex.inputs().front(), len * sizeof(value_t));
+
+  len = ex.vars().size();
+  s->append((char*)&len, sizeof(len));
+  for (map<var_t,type_t>::const_iterator i = ex.vars().begin();
+       i != ex.vars().end(); ++i) {
+    s->append((char*)&i->first, sizeof(var_t));
+    s->push_back(static_cast<char>(i->second));
+  }
+
+  const vector<SymbolicPred*>& constraints = ex.path().constraints();
+  len = constraints.size();
+  s->append((char*)&len, sizeof(len));
+  for (size_t i = 0; i < constraints.size(); i++) {
+    constraints[i]->Serialize(s);
+  }
+}
+
+bool ParseQueries(istream& s,
+                  vector<value_t>* inputs,
+                  map<var_t,type_t>* vars,
+                  vector<SymbolicPred*>* constraints) {
+  size_t len;
+  s.read((char*)&len, sizeof(len));
+  inputs->resize(len);
+  if (len > 0)
+    s.read((char*)&inputs->front(), len * sizeof(value_t));
+
+  s.read((char*)&len, sizeof(len));
+  vars->clear();
+  for (size_t i = 0; i < len; i++) {
+    var_t v;
+    s.read((char*)&v, sizeof(v));
+    (*vars)[v] = static_cast<type_t>(s.get());
+  }
+
+  for (size_t i = 0; i < constraints->size(); i++)
+    delete (*constraints)[i];
+  s.read((char*)&len, sizeof(len));
+  constraints->resize(len);
+  for (size_t i = 0; i < len; i++) {
+    (*constraints)[i] = new SymbolicPred();
+    if (!(*constraints)[i]->Parse(s))
+      return false;
+  }
+
+  return !s.fail();
+}
+
+}  // namespace
+
+
+SolverPool::SolverPool(Solver* solver, int num_workers)
+  : solver_(solver), num_workers_(num_workers > 0 ? num_workers : 0) { }
+
+
+SolverPool::~SolverPool() {
+  // Closing the request pipes tells the workers to exit.
+  for (size_t i = 0; i < workers_.size(); i++) {
+    CloseParentFd(workers_[i].to_fd);
+    CloseParentFd(workers_[i].from_fd);
+  }
+  for (size_t i = 0; i < workers_.size(); i++) {
+    waitpid(workers_[i].pid, NULL, 0);
+  }
+}
+
+
+Solver::Stats SolverPool::stats() const {
+  Solver::Stats total = solver_->stats();
+  total.Add(retired_stats_);
+  for (size_t i = 0; i < workers_.size(); i++) {
+    total.Add(workers_[i].stats);
+  }
+  return total;
+}
+
+
+SolverPool::Worker SolverPool::SpawnWorker() {
+  int to[2], from[2];
+  if (pipe(to) || pipe(from)) {
+    perror("Failed to create solver pipes");
+    exit(-1);
+  }
+  pid_t pid = fork();
+  if (pid == -1) {
+    perror("Failed to fork solver worker");
+    exit(-1);
+  }
+
+  if (!pid) {
+    // Worker: drop the ends of the pipes (and any other workers'
+    // pipes) that belong to the parent.
+    close(to[1]);
+    close(from[0]);
+    for (set<int>::const_iterator i = parent_fds.begin();
+         i != parent_fds.end(); ++i) {
+      close(*i);
+    }
+    WorkerLoop(to[0], from[1]);
+    _exit(0);
+  }
+
+  close(to[0]);
+  close(from[1]);
+  parent_fds.insert(to[1]);
+  parent_fds.insert(from[0]);
+  Worker w;
+  w.pid = pid;
+  w.to_fd = to[1];
+  w.from_fd = from[0];
+  w.stats = Solver::Stats();
+  return w;
+}
+
+
+void SolverPool::StartWorkers() {
+  // Timed queries need a worker even if none were requested.
+  int n = max(1, num_workers_);
+  for (int i = 0; i < n; i++) {
+    workers_.push_back(SpawnWorker());
+  }
+}
+
+
+void SolverPool::RestartWorker(size_t w, double elapsed) {
+  kill(workers_[w].pid, SIGKILL);
+  CloseParentFd(workers_[w].to_fd);
+  CloseParentFd(workers_[w].from_fd);
+  waitpid(workers_[w].pid, NULL, 0);
+
+  // Keep the statistics of the dead worker, counting the query it was
+  // killed for as unknown.
+  retired_stats_.Add(workers_[w].stats);
+  retired_stats_.num_queries ++;
+  retired_stats_.num_unknown ++;
+  retired_stats_.solve_time += elapsed;
+
+  workers_[w].to_fd = workers_[w].from_fd = -1;
+  workers_[w] = SpawnWorker();
+}
+
+
+void SolverPool::WorkerLoop(int in_fd, int out_fd) {
+  vector<value_t> old_input;
+  map<var_t,type_t> vars;
+  vector<SymbolicPred*> constraints;
+  vector<value_t> input;
+
+  // Only this worker's queries count towards its statistics.
+  solver_->ResetStats();
+
+  char type;
+  while (ReadFully(in_fd, &type, 1)) {
+    if (type == 'E') {
+      // A new execution to solve against.
+      size_t len;
+      if (!ReadFully(in_fd, &len, sizeof(len)))
+        break;
+      string buff(len, '\0');
+      if (!ReadFully(in_fd, &buff[0], len))
+        break;
+      istringstream in(buff);
+      bool parsed = ParseQueries(in, &old_input, &vars, &constraints);
+      assert(parsed);
+
+    } else {
+      // A constraint index to negate and solve (and a time limit).
+      assert(type == 'Q');
+      size_t idx;
+      double timeout;
+      if (!ReadFully(in_fd, &idx, sizeof(idx))
+          || !ReadFully(in_fd, &timeout, sizeof(timeout)))
+        break;
+      solver_->set_timeout(timeout);
+      char result = SolveInProcess(vars, old_input, constraints, idx, &input);
+      WriteOrDie(out_fd, &solver_->stats(), sizeof(Solver::Stats));
+      WriteOrDie(out_fd, &result, 1);
+      if (result == results::SAT) {
+        size_t len = input.size();
+        WriteOrDie(out_fd, &len, sizeof(len));
+        if (len > 0)
+          WriteOrDie(out_fd, &input.front(), len * sizeof(value_t));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < constraints.size(); i++)
+    delete constraints[i];
+}
+
+
+void SolverPool::SendExecution(size_t w, const string& buff) {
+  size_t len = buff.size();
+  WriteOrDie(workers_[w].to_fd, "E", 1);
+  WriteOrDie(workers_[w].to_fd, &len, sizeof(len));
+  WriteOrDie(workers_[w].to_fd, buff.data(), len);
+}
+
+
+void SolverPool::SendQuery(size_t w, size_t idx, double timeout) {
+  WriteOrDie(workers_[w].to_fd, "Q", 1);
+  WriteOrDie(workers_[w].to_fd, &idx, sizeof(idx));
+  WriteOrDie(workers_[w].to_fd, &timeout, sizeof(timeout));
+}
+
+
+void SolverPool::ReadResult(size_t w,
+                            solve_result_t* result,
+                            vector<value_t>* input) {
+  int fd = workers_[w].from_fd;
+  char res;
+  bool ok = (ReadFully(fd, &workers_[w].stats, sizeof(Solver::Stats))
+             && ReadFully(fd, &res, 1));
+  if (ok && (res == results::SAT)) {
+    size_t len;
+    ok = ReadFully(fd, &len, sizeof(len));
+    if (ok) {
+      input->resize(len);
+      ok = (len == 0) || ReadFully(fd, &input->front(), len * sizeof(value_t));
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "Solver worker %d died.\n", workers_[w].pid);
+    exit(-1);
+  }
+  *result = static_cast<solve_result_t>(res);
+}
+
+
+solve_result_t SolverPool::SolveInProcess(const map<var_t,type_t>& vars,
+                                          const vector<value_t>& old_input,
+                                          const vector<SymbolicPred*>& constraints,
+                                          size_t idx,
+                                          vector<value_t>* input) {
+
+  // Optimization: If any of the previous constraints are idential to the
+  // idx-th constraint, immediately return UNSAT.
+  for (int i = static_cast<int>(idx) - 1; i >= 0; i--) {
+    if (constraints[idx]->Equal(*constraints[i]))
+      return results::UNSAT;
+  }
+
+  // Negate a copy of the idx-th constraint, so that the (possibly
+  // shared) execution is never modified.
+  SymbolicPred negated(NegateCompareOp(constraints[idx]->op()),
+                       new SymbolicExpr(constraints[idx]->expr()));
+  vector<const SymbolicPred*> cs(constraints.begin(),
+                                 constraints.begin()+idx);
+  cs.push_back(&negated);
+
+  map<var_t,value_t> soln;
+  solve_result_t result = solver_->IncrementalSolve(old_input, vars, cs, &soln);
+  if (result != results::SAT)
+    return result;
+
+  // Merge the solution with the previous input to get the next
+  // input.  (Could merge with random inputs, instead.)
+  *input = old_input;
+  typedef map<var_t,value_t>::const_iterator SolnIt;
+  for (SolnIt i = soln.begin(); i != soln.end(); ++i) {
+    (*input)[i->first] = i->second;
+  }
+  return results::SAT;
+}
+
+
+void SolverPool::SolveInProcessBatch(const SymbolicExecution& ex,
+                                     const vector<size_t>& idxs,
+                                     vector<solve_result_t>* solved,
+                                     vector< vector<value_t> >* inputs,
+                                     vector<double>* seconds) {
+  const vector<SymbolicPred*>& constraints = ex.path().constraints();
+
+  // Negate copies of the constraints, skipping any constraint identical
+  // to an earlier one (as in SolveInProcess).
+  vector<size_t> ks;
+  vector<size_t> todo;
+  vector<const SymbolicPred*> negations;
+  for (size_t k = 0; k < idxs.size(); k++) {
+    size_t idx = idxs[k];
+    bool repeated = false;
+    for (int i = static_cast<int>(idx) - 1; (i >= 0) && !repeated; i--) {
+      repeated = constraints[idx]->Equal(*constraints[i]);
+    }
+    if (repeated) {
+      (*solved)[k] = results::UNSAT;
+      continue;
+    }
+    ks.push_back(k);
+    todo.push_back(idx);
+    negations.push_back(new SymbolicPred(NegateCompareOp(constraints[idx]->op()),
+                                         new SymbolicExpr(constraints[idx]->expr())));
+  }
+
+  vector<const SymbolicPred*> cs(constraints.begin(), constraints.end());
+  vector<solve_result_t> res;
+  vector< map<var_t,value_t> > solns;
+  vector<double> times;
+  solver_->SolveNegations(ex.vars(), cs, negations, todo, &res, &solns, &times);
+
+  typedef map<var_t,value_t>::const_iterator SolnIt;
+  for (size_t j = 0; j < ks.size(); j++) {
+    size_t k = ks[j];
+    (*solved)[k] = res[j];
+    (*seconds)[k] = times[j];
+    if (res[j] == results::SAT) {
+      (*inputs)[k] = ex.inputs();
+      for (SolnIt i = solns[j].begin(); i != solns[j].end(); ++i) {
+        (*inputs)[k][i->first] = i->second;
+      }
+    }
+    delete negations[j];
+  }
+}
+
+
+solve_result_t SolverPool::Solve(const SymbolicExecution& ex,
+                                 size_t idx,
+                                 double timeout,
+                                 vector<value_t>* input) {
+  vector<size_t> idxs(1, idx);
+  vector<solve_result_t> res;
+  vector< vector<value_t> > inputs;
+  vector<double> seconds;
+  SolveBatch(ex, idxs, timeout, &res, &inputs, &seconds);
+  if (res[0] == results::SAT)
+    input->swap(inputs[0]);
+  return res[0];
+}
+
+
+void SolverPool::SolveBatch(const SymbolicExecution& ex,
+                            const vector<size_t>& idxs,
+                            double timeout,
+                            vector<solve_result_t>* solved,
+                            vector< vector<value_t> >* inputs,
+                            vector<double>* seconds) {
+  solved->assign(idxs.size(), results::UNSAT);
+  inputs->resize(idxs.size());
+  seconds->assign(idxs.size(), 0);
+
+  // Only a worker can be stopped in the middle of a Yices query.
+  bool must_kill = (timeout > 0) && !solver_->SupportsTimeout();
+
+  if (!must_kill && ((num_workers_ == 0) || (idxs.size() <= 1))) {
+    solver_->set_timeout(timeout);
+
+    bool increasing = (idxs.size() > 1);
+    for (size_t k = 1; k < idxs.size(); k++) {
+      increasing = increasing && (idxs[k-1] < idxs[k]);
+    }
+    if (increasing) {
+      SolveInProcessBatch(ex, idxs, solved, inputs, seconds);
+      return;
+    }
+
+    for (size_t k = 0; k < idxs.size(); k++) {
+      double start = solver_->stats().solve_time;
+      (*solved)[k] = SolveInProcess(ex.vars(), ex.inputs(),
+                                     ex.path().constraints(), idxs[k],
+                                     &(*inputs)[k]);
+      (*seconds)[k] = solver_->stats().solve_time - start;
+    }
+    return;
+  }
+
+  if (workers_.empty())
+    StartWorkers();
+
+  // Send the execution to every worker that will receive a query.
+  string buff;
+  SerializeQueries(ex, &buff);
+  size_t num_active = min(workers_.size(), idxs.size());
+  for (size_t w = 0; w < num_active; w++) {
+    SendExecution(w, buff);
+  }
+
+  // Hand out queries in priority order as workers become idle.
+  vector<size_t> assigned(num_active);
+  vector<double> deadline(num_active);
+  vector<struct pollfd> fds(num_active);
+  size_t next = 0;
+  double now = WallTime();
+  for (size_t w = 0; w < num_active; w++, next++) {
+    assigned[w] = next;
+    deadline[w] = now + timeout;
+    SendQuery(w, idxs[next], timeout);
+    fds[w].fd = workers_[w].from_fd;
+    fds[w].events = POLLIN;
+  }
+
+  size_t outstanding = num_active;
+  while (outstanding > 0) {
+    // Wait no longer than the earliest deadline.
+    int wait_ms = -1;
+    if (timeout > 0) {
+      double earliest = 0;
+      for (size_t w = 0; w < num_active; w++) {
+        if ((fds[w].fd >= 0) && ((earliest == 0) || (deadline[w] < earliest)))
+          earliest = deadline[w];
+      }
+      wait_ms = static_cast<int>(max(0.0, 1000 * (earliest - WallTime())) + 1);
+    }
+
+    if (poll(&fds.front(), fds.size(), wait_ms) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("Error waiting for solver workers");
+      exit(-1);
+    }
+
+    now = WallTime();
+    for (size_t w = 0; w < num_active; w++) {
+      if (fds[w].fd < 0)
+        continue;
+
+      size_t k = assigned[w];
+      if (fds[w].revents & (POLLIN | POLLHUP)) {
+        // Collect the result.  (Each reply carries the worker's total
+        // solving time, which grows by the time of this query.)
+        double before = workers_[w].stats.solve_time;
+        ReadResult(w, &(*solved)[k], &(*inputs)[k]);
+        (*seconds)[k] = workers_[w].stats.solve_time - before;
+      } else if ((timeout > 0) && (now >= deadline[w])) {
+        // Out of time -- replace the worker with a fresh one.
+        (*seconds)[k] = now - (deadline[w] - timeout);
+        RestartWorker(w, (*seconds)[k]);
+        (*solved)[k] = results::UNKNOWN;
+        fds[w].fd = workers_[w].from_fd;
+        if (next < idxs.size())
+          SendExecution(w, buff);
+      } else {
+        continue;
+      }
+
+      // Give the worker the next query, or retire it for this batch.
+      if (next < idxs.size()) {
+        assigned[w] = next;
+        deadline[w] = now + timeout;
+        SendQuery(w, idxs[next], timeout);
+        next++;
+      } else {
+        fds[w].fd = -1;
+        outstanding--;
+      }
+    }
+  }
+}
+
+}  // namespace crest
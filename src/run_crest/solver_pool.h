@@ -0,0 +1,125 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+#ifndef RUN_CREST_SOLVER_POOL_H__
+#define RUN_CREST_SOLVER_POOL_H__
+
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "base/basic_types.h"
+#include "base/solver.h"
+#include "base/symbolic_execution.h"
+#include "base/symbolic_predicate.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace crest {
+
+//
+// A pool of solver worker processes, which solve batches of branch
+// negations on a single execution concurrently.
+//
+// Workers are separate (forked) processes rather than threads, because
+// the Yices 1 library is not reentrant.  Each worker is sent the path
+// constraints of an execution once per batch, and is then handed
+// constraint indices to negate and solve, one at a time, as it
+// becomes idle.
+//
+// With zero workers, all queries are solved in the calling process --
+// a batch of queries at increasing positions along the path is solved
+// incrementally, in one solver context.  Either way, queries are solved
+// with the given solver backend (of which each worker has its own copy).
+//
+// Queries can be given a timeout.  As Yices cannot be interrupted, a
+// timeout is enforced by killing the worker solving the query (and
+// starting a fresh one), so timed queries always go to a worker --
+// even with zero workers requested, one is started for them.
+//
+class SolverPool {
+ public:
+  SolverPool(Solver* solver, int num_workers);
+  ~SolverPool();
+
+  int num_workers() const { return num_workers_; }
+
+  // Statistics for all queries, whether solved in-process or by workers.
+  Solver::Stats stats() const;
+
+  // Tries to solve for an input which follows the path of 'ex' up to
+  // constraint 'idx', and then takes the opposite branch.  Gives up,
+  // returning UNKNOWN, after 'timeout' seconds (if non-zero).
+  solve_result_t Solve(const SymbolicExecution& ex,
+                       size_t idx,
+                       double timeout,
+                       vector<value_t>* input);
+
+  // As Solve, for each of the constraints idxs[k].  On return,
+  // (*solved)[k] and (*inputs)[k] hold the result for idxs[k] -- i.e.
+  // results come back in the (priority) order of 'idxs' -- and
+  // (*seconds)[k] the time spent solving it (by whichever process did).
+  void SolveBatch(const SymbolicExecution& ex,
+                  const vector<size_t>& idxs,
+                  double timeout,
+                  vector<solve_result_t>* solved,
+                  vector< vector<value_t> >* inputs,
+                  vector<double>* seconds);
+
+ private:
+  struct Worker {
+    pid_t pid;
+    int to_fd;    // Requests to the worker.
+    int from_fd;  // Replies from the worker.
+    Solver::Stats stats;  // As of the worker's last reply.
+  };
+
+  Solver* solver_;
+  const int num_workers_;
+  vector<Worker> workers_;
+
+  // Statistics of killed workers (and of the queries they were killed
+  // for).
+  Solver::Stats retired_stats_;
+
+  Worker SpawnWorker();
+  void StartWorkers();
+  void RestartWorker(size_t w, double elapsed);
+  void WorkerLoop(int in_fd, int out_fd);
+
+  void SendExecution(size_t w, const string& buff);
+  void SendQuery(size_t w, size_t idx, double timeout);
+  void ReadResult(size_t w, solve_result_t* result, vector<value_t>* input);
+
+  // Solves the whole batch in this process, sharing one solver context
+  // across the queries (see Solver::SolveNegations).  'idxs' must be in
+  // increasing order.
+  void SolveInProcessBatch(const SymbolicExecution& ex,
+                           const vector<size_t>& idxs,
+                           vector<solve_result_t>* solved,
+                           vector< vector<value_t> >* inputs,
+                           vector<double>* seconds);
+
+  // Tries to solve for an input which satisfies constraints[0..idx-1]
+  // and the negation of constraints[idx], in this process.  The
+  // constraints themselves are left unmodified.
+  solve_result_t SolveInProcess(const map<var_t,type_t>& vars,
+                                const vector<value_t>& old_input,
+                                const vector<SymbolicPred*>& constraints,
+                                size_t idx,
+                                vector<value_t>* input);
+};
+
+}  // namespace crest
+
+#endif  // RUN_CREST_SOLVER_POOL_H__
@@ -0,0 +1,230 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+//
+// Compares the branch and CFG metadata ("branches", "cfg", and
+// "cfg_func_map") of two instrumented builds of a program, and prints
+// the branches of the new build which are in new or changed functions
+// -- the targets for "run_crest -directed".
+//
+// Usage: diff_branches OLD_DIR NEW_DIR
+//
+// Functions are matched by name.  A function is unchanged if its CFG and
+// branches are the same, up to the renumbering of the statements.  (The
+// metadata does not name static functions, so each is compared as part
+// of the function before it.  And a change which leaves the CFG as it
+// was -- e.g. to a constant in a condition -- goes unnoticed.)
+//
+
+#include <ctype.h>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Build {
+  // The function starting at each statement id.
+  map<int,string> functions;
+  // The successors (and calls) of each statement.
+  map<int, vector<string> > cfg;
+  // The pairs of branches.
+  vector< pair<int,int> > branches;
+};
+
+bool ReadBuild(const string& dir, Build* build) {
+  { ifstream in((dir + "/branches").c_str());
+    if (!in)
+      return false;
+    int fid, num_branches;
+    while (in >> fid >> num_branches) {
+      for (int i = 0; i < num_branches; i++) {
+        int b1, b2;
+        if (!(in >> b1 >> b2))
+          return false;
+        build->branches.push_back(make_pair(b1, b2));
+      }
+    }
+  }
+
+  { ifstream in((dir + "/cfg_func_map").c_str());
+    if (!in)
+      return false;
+    string func;
+    int sid;
+    while (in >> func >> sid) {
+      build->functions[sid] = func;
+    }
+  }
+
+  ifstream in((dir + "/cfg").c_str());
+  if (!in)
+    return false;
+  string line;
+  while (getline(in, line)) {
+    istringstream line_in(line);
+    int src;
+    if (!(line_in >> src))
+      continue;
+    vector<string>& succs = build->cfg[src];
+    string dst;
+    while (line_in >> dst) {
+      succs.push_back(dst);
+    }
+  }
+  return true;
+}
+
+// Returns the function containing statement 'sid' (or "", before the
+// first function), and sets 'offset' to its offset in the function.
+const string& FunctionOf(const Build& build, int sid, int* offset) {
+  static const string kNone;
+  map<int,string>::const_iterator it = build.functions.upper_bound(sid);
+  if (it == build.functions.begin()) {
+    *offset = sid;
+    return kNone;
+  }
+  --it;
+  *offset = sid - it->first;
+  return it->second;
+}
+
+// Appends statement 'sid' to 'out', relative to the start of its
+// function (and naming the function, if not 'func').
+void AppendStmt(const Build& build, const string& func, int sid,
+                ostringstream* out) {
+  int offset;
+  const string& f = FunctionOf(build, sid, &offset);
+  if (f != func)
+    *out << f;
+  *out << "+" << offset;
+}
+
+// Computes a summary of each function (see the top of this file), which
+// does not depend on how the statements are numbered.
+void Summarize(const Build& build, map<string,string>* summaries) {
+  map<string,ostringstream*> out;
+  for (map<int, vector<string> >::const_iterator i = build.cfg.begin();
+       i != build.cfg.end(); ++i) {
+    int offset;
+    const string& func = FunctionOf(build, i->first, &offset);
+    ostringstream*& s = out[func];
+    if (!s)
+      s = new ostringstream;
+    *s << offset << ":";
+    for (size_t j = 0; j < i->second.size(); j++) {
+      const string& dst = i->second[j];
+      *s << " ";
+      if (isdigit(dst[0])) {
+        AppendStmt(build, func, atoi(dst.c_str()), s);
+      } else {
+        // (A call to a function in another file.)
+        *s << dst;
+      }
+    }
+    *s << "\n";
+  }
+
+  for (size_t i = 0; i < build.branches.size(); i++) {
+    int offset;
+    const string& func = FunctionOf(build, build.branches[i].first, &offset);
+    ostringstream*& s = out[func];
+    if (!s)
+      s = new ostringstream;
+    *s << "branch " << offset << " ";
+    AppendStmt(build, func, build.branches[i].second, s);
+    *s << "\n";
+  }
+
+  for (map<string,ostringstream*>::iterator i = out.begin();
+       i != out.end(); ++i) {
+    (*summaries)[i->first] = i->second->str();
+    delete i->second;
+  }
+}
+
+}  // namespace
+
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "Syntax: diff_branches <old build dir> <new build dir>\n");
+    return 1;
+  }
+
+  Build old_build, new_build;
+  if (!ReadBuild(argv[1], &old_build)) {
+    fprintf(stderr, "Failed to read the metadata in %s.\n", argv[1]);
+    return 1;
+  }
+  if (!ReadBuild(argv[2], &new_build)) {
+    fprintf(stderr, "Failed to read the metadata in %s.\n", argv[2]);
+    return 1;
+  }
+
+  map<string,string> old_summaries, new_summaries;
+  Summarize(old_build, &old_summaries);
+  Summarize(new_build, &new_summaries);
+
+  set<string> changed;
+  int num_unchanged = 0, num_new = 0;
+  for (map<string,string>::const_iterator i = new_summaries.begin();
+       i != new_summaries.end(); ++i) {
+    map<string,string>::const_iterator old = old_summaries.find(i->first);
+    const char* name = i->first.empty() ? "(before any function)"
+                                        : i->first.c_str();
+    if (old == old_summaries.end()) {
+      fprintf(stderr, "New: %s\n", name);
+      changed.insert(i->first);
+      num_new++;
+    } else if (old->second != i->second) {
+      fprintf(stderr, "Changed: %s\n", name);
+      changed.insert(i->first);
+    } else {
+      num_unchanged++;
+    }
+  }
+  int num_removed = 0;
+  for (map<string,string>::const_iterator i = old_summaries.begin();
+       i != old_summaries.end(); ++i) {
+    if (!new_summaries.count(i->first))
+      num_removed++;
+  }
+
+  // Print the targets: both branches of each pair in a changed function.
+  set<int> targets;
+  for (size_t i = 0; i < new_build.branches.size(); i++) {
+    int offset;
+    if (changed.count(FunctionOf(new_build, new_build.branches[i].first,
+                                 &offset))) {
+      targets.insert(new_build.branches[i].first);
+      targets.insert(new_build.branches[i].second);
+    }
+  }
+  for (set<int>::const_iterator i = targets.begin(); i != targets.end(); ++i) {
+    printf("%d\n", *i);
+  }
+
+  fprintf(stderr, "Functions: %d unchanged, %d changed, %d new, %d removed.\n",
+          num_unchanged, static_cast<int>(changed.size()) - num_new, num_new,
+          num_removed);
+  fprintf(stderr, "Target branches: %d of %d.\n",
+          static_cast<int>(targets.size()),
+          static_cast<int>(2 * new_build.branches.size()));
+  return 0;
+}
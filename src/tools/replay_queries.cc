@@ -0,0 +1,163 @@
+// Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+//
+// This file is part of CREST, which is distributed under the revised
+// BSD license.  A copy of this license can be found in the file LICENSE.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+// for details.
+
+//
+// Replays the solver queries dumped by "run_crest --dump_queries=DIR"
+// against a solver backend, and reports throughput and latency.
+//
+// Usage: replay_queries DIR [--solver=NAME] [--timeout=SECONDS] [--repeat=N]
+//
+
+#include <algorithm>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "base/smt_lib.h"
+#include "base/solver.h"
+
+using namespace crest;
+using namespace std;
+
+namespace {
+
+double WallTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+struct Query {
+  string file;
+  string recorded_result;
+  double recorded_time;
+};
+
+double Percentile(const vector<double>& sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  size_t i = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+}  // namespace
+
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "Syntax: replay_queries <dir> [--solver=NAME] [--timeout=SECONDS]"
+            " [--repeat=N]\n");
+    return 1;
+  }
+
+  string dir = argv[1];
+  string solver_name = "yices";
+  double timeout = 0;
+  int repeat = 1;
+  for (int i = 2; i < argc; i++) {
+    if (!strncmp(argv[i], "--solver=", 9)) {
+      solver_name = argv[i] + 9;
+    } else if (!strncmp(argv[i], "--timeout=", 10)) {
+      timeout = atof(argv[i] + 10);
+    } else if (!strncmp(argv[i], "--repeat=", 9)) {
+      repeat = atoi(argv[i] + 9);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  Solver* solver = Solver::Create(solver_name);
+  if (!solver) {
+    fprintf(stderr, "Unknown solver: %s\n", solver_name.c_str());
+    return 1;
+  }
+  // (Only backends which support timeouts honor this.)
+  solver->set_timeout(timeout);
+
+  // Read the index.
+  vector<Query> queries;
+  {
+    ifstream in((dir + "/index").c_str());
+    if (!in) {
+      fprintf(stderr, "Failed to open %s/index.\n", dir.c_str());
+      return 1;
+    }
+    Query q;
+    while (in >> q.file >> q.recorded_result >> q.recorded_time) {
+      queries.push_back(q);
+    }
+  }
+
+  vector<double> latencies;
+  double recorded_total = 0;
+  unsigned num_sat = 0, num_unsat = 0, num_unknown = 0, num_mismatches = 0;
+  double start = WallTime();
+
+  for (int r = 0; r < repeat; r++) {
+    for (size_t i = 0; i < queries.size(); i++) {
+      const Query& q = queries[i];
+      map<var_t,type_t> vars;
+      vector<SymbolicPred*> constraints;
+      ifstream in((dir + "/" + q.file).c_str());
+      if (!in || !ParseSmtLib(in, &vars, &constraints)) {
+        fprintf(stderr, "Failed to parse %s/%s.\n", dir.c_str(), q.file.c_str());
+        return 1;
+      }
+
+      vector<const SymbolicPred*> cs(constraints.begin(), constraints.end());
+      map<var_t,value_t> soln;
+      double t = WallTime();
+      solve_result_t result = solver->Solve(vars, cs, &soln);
+      latencies.push_back(WallTime() - t);
+      recorded_total += q.recorded_time;
+
+      switch (result) {
+      case results::SAT:   num_sat++; break;
+      case results::UNSAT: num_unsat++; break;
+      default:             num_unknown++; break;
+      }
+      string name = SolveResultName(result);
+      if ((result != results::UNKNOWN) && (q.recorded_result != "unknown")
+          && (name != q.recorded_result)) {
+        fprintf(stderr, "Result mismatch on %s: %s (recorded %s)\n",
+                q.file.c_str(), name.c_str(), q.recorded_result.c_str());
+        num_mismatches++;
+      }
+
+      for (size_t j = 0; j < constraints.size(); j++)
+        delete constraints[j];
+    }
+  }
+
+  double total = WallTime() - start;
+  double solve_total = 0;
+  for (size_t i = 0; i < latencies.size(); i++)
+    solve_total += latencies[i];
+  sort(latencies.begin(), latencies.end());
+
+  printf("Solver: %s\n", solver->name());
+  printf("Queries: %zu (%u sat, %u unsat, %u unknown, %u mismatches)\n",
+         latencies.size(), num_sat, num_unsat, num_unknown, num_mismatches);
+  printf("Solve time: %.3fs (recorded: %.3fs), total %.3fs\n",
+         solve_total, recorded_total, total);
+  printf("Throughput: %.1f queries/s\n",
+         (solve_total > 0) ? latencies.size() / solve_total : 0.0);
+  printf("Latency (ms): p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+         1000 * Percentile(latencies, 0.50), 1000 * Percentile(latencies, 0.90),
+         1000 * Percentile(latencies, 0.99),
+         1000 * (latencies.empty() ? 0 : latencies.back()));
+
+  delete solver;
+  return 0;
+}
@@ -0,0 +1,43 @@
+/* Copyright (c) 2008, Jacob Burnim (jburnim@cs.berkeley.edu)
+ *
+ * This file is part of CREST, which is distributed under the revised
+ * BSD license.  A copy of this license can be found in the file LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See LICENSE
+ * for details.
+ */
+
+#include <crest.h>
+#include <limits.h>
+#include <stdio.h>
+
+/*
+ * The loop below leaves a run of bounds (x > 3, x > 5, x > 7) on each
+ * path, each implied by the next, which the constraint simplifier drops
+ * before solving.  All 6 paths -- and so every branch -- should be
+ * covered with or without the simplifier.
+ */
+int main(void) {
+  int x, i;
+  CREST_int(x);
+
+  for (i = 3; i <= 7; i += 2) {
+    if (x > i) {
+      printf("x > %d\n", i);
+    }
+  }
+
+  /* Taken only by x == 8 (when all of the bounds above hold). */
+  if (2*x + 1 == 17) {
+    printf("x == 8\n");
+  }
+
+  /* A bound at the very edge of the range of int. */
+  if (x != INT_MAX) {
+    printf("x != INT_MAX\n");
+  }
+
+  return 0;
+}